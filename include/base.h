@@ -15,6 +15,10 @@
 #include <freetype/ftstroke.h>
 #include <iostream>
 #include <iomanip>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <bitset>
 #include <vector>
 #include <string>
 #include <regex>
@@ -29,6 +33,9 @@
 #include <fstream>
 #include <filesystem>
 #include <chrono>
+#include <thread>
+#include <random>
+#include <functional>
 
 #include "project_constants.h"
 
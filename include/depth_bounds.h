@@ -0,0 +1,38 @@
+#pragma once
+
+#include "base.h"
+
+// the nearest and farthest visible depths in the view space, reduced on the gpu from the depth buffer.
+class DepthBoundsGL final
+{
+public:
+   DepthBoundsGL();
+   ~DepthBoundsGL();
+
+   DepthBoundsGL(const DepthBoundsGL&) = delete;
+   DepthBoundsGL(const DepthBoundsGL&&) = delete;
+   DepthBoundsGL& operator=(const DepthBoundsGL&) = delete;
+   DepthBoundsGL& operator=(const DepthBoundsGL&&) = delete;
+
+   void reduce(int width, int height);
+   [[nodiscard]] bool isAvailable() const { return Available; }
+   [[nodiscard]] const glm::vec2& getBounds() const { return Bounds; }
+   [[nodiscard]] static int getGroupSize() { return GroupSize; }
+
+private:
+   // the results are read a few frames later so that the readback never stalls the pipeline.
+   inline static constexpr int ReadbackFrameNum = 3;
+
+   // depth_bounds.comp is built with it as GROUP_SIZE.
+   inline static constexpr int GroupSize = 16;
+
+   int Current;
+   bool Available;
+   glm::vec2 Bounds;
+   GLuint ReductionBuffer;
+   GLuint ReadbackBuffer;
+   const GLuint* ReadbackData;
+   std::array<GLsync, ReadbackFrameNum> Fences;
+
+   void collectBounds(int index);
+};
\ No newline at end of file
@@ -6,7 +6,12 @@ class LightGL final
 {
 public:
    LightGL();
-   ~LightGL() = default;
+   ~LightGL();
+
+   LightGL(const LightGL&) = delete;
+   LightGL(const LightGL&&) = delete;
+   LightGL& operator=(const LightGL&) = delete;
+   LightGL& operator=(const LightGL&&) = delete;
 
    [[nodiscard]] bool isLightOn() const;
    void toggleLightSwitch();
@@ -22,14 +27,64 @@ public:
    );
    void activateLight(const int& light_index);
    void deactivateLight(const int& light_index);
-   void transferUniformsToShader(const ShaderGL* shader);
+   void updateLightBuffer(const glm::mat4& view_matrix);
+   void updateLightStorageBuffer(const glm::mat4& view_matrix);
    [[nodiscard]] int getTotalLightNum() const { return TotalLightNum; }
+   [[nodiscard]] static int getMaxLightNum() { return MaxLightNum; }
    [[nodiscard]] glm::vec4 getLightPosition(int light_index) { return Positions[light_index]; }
+   [[nodiscard]] bool isActivated(int light_index) const { return IsActivated[light_index]; }
+   [[nodiscard]] const glm::vec4& getDiffuseColor(int light_index) const { return DiffuseColors[light_index]; }
+   [[nodiscard]] const glm::vec3& getSpotlightDirection(int light_index) const
+   {
+      return SpotlightDirections[light_index];
+   }
+   [[nodiscard]] float getSpotlightCutoffAngle(int light_index) const { return SpotlightCutoffAngles[light_index]; }
+   [[nodiscard]] float getFallOffRadius(int light_index) const { return FallOffRadii[light_index]; }
 
 private:
+   // the scene shaders are built with it as MAX_LIGHTS, and the binding should be matched with LightBlock.
+   inline static constexpr int MaxLightNum = 32;
+   inline static constexpr GLuint LightBindingPoint = 0;
+
+   // it should be matched with the binding of LightStorage in light_culling.comp and the clustered scene shaders.
+   inline static constexpr GLuint LightStorageBindingPoint = 1;
+
+   // they follow the std140 layout of LightInfo and LightBlock in the scene shaders.
+   // the std430 layout of LightStorage is the same for LightInfo.
+   struct LightInfo
+   {
+      glm::vec4 Position;
+      glm::vec4 AmbientColor;
+      glm::vec4 DiffuseColor;
+      glm::vec4 SpecularColor;
+      glm::vec3 SpotlightDirection;
+      float SpotlightCutoffCosine;
+      float SpotlightCutoffAngle;
+      float SpotlightFeather;
+      float FallOffRadius;
+      int LightSwitch;
+   };
+   static_assert( sizeof( LightInfo ) == 96 );
+
+   struct LightBlock
+   {
+      glm::vec4 GlobalAmbient;
+      int UseLight;
+      int LightNum;
+      std::array<int, 2> Padding;
+      std::array<LightInfo, MaxLightNum> Lights;
+   };
+   static_assert( offsetof( LightBlock, Lights ) == 32 );
+
    bool TurnLightOn;
+   bool IsLightBufferUploaded;
    int TotalLightNum;
+   GLuint LightUBO;
+   GLuint LightSSBO;
+   int LightStorageCapacity;
    glm::vec4 GlobalAmbientColor;
+   LightBlock UploadedLightBlock;
+   std::vector<LightInfo> UploadedLightStorage;
    std::vector<bool> IsActivated;
    std::vector<glm::vec4> Positions;
    std::vector<glm::vec4> AmbientColors;
@@ -39,4 +94,6 @@ private:
    std::vector<float> SpotlightCutoffAngles;
    std::vector<float> SpotlightFeathers;
    std::vector<float> FallOffRadii;
+
+   [[nodiscard]] LightInfo getLightInfo(int light_index, const glm::mat4& view_matrix) const;
 };
\ No newline at end of file
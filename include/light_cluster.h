@@ -0,0 +1,39 @@
+#pragma once
+
+#include "base.h"
+
+// the view frustum is divided into the froxels of a 3D grid, and each of them lists the indices of the lights
+// that reach it, so the scene shaders evaluate only a bounded number of lights however many there are.
+class LightClusterGL final
+{
+public:
+   LightClusterGL();
+   ~LightClusterGL();
+
+   LightClusterGL(const LightClusterGL&) = delete;
+   LightClusterGL(const LightClusterGL&&) = delete;
+   LightClusterGL& operator=(const LightClusterGL&) = delete;
+   LightClusterGL& operator=(const LightClusterGL&&) = delete;
+
+   void cull() const;
+   [[nodiscard]] static glm::ivec3 getGridSize() { return { GridWidth, GridHeight, SliceNum }; }
+   [[nodiscard]] static int getMaxLightNumPerCluster() { return MaxLightNumPerCluster; }
+   [[nodiscard]] static int getGroupSize() { return GroupSize; }
+
+private:
+   inline static constexpr int GridWidth = 16;
+   inline static constexpr int GridHeight = 9;
+   inline static constexpr int SliceNum = 24;
+   inline static constexpr int ClusterNum = GridWidth * GridHeight * SliceNum;
+
+   // light_culling.comp and the scene shader are built with them as GROUP_SIZE and MAX_LIGHTS_PER_CLUSTER.
+   inline static constexpr int GroupSize = 128;
+   inline static constexpr int MaxLightNumPerCluster = 128;
+
+   // they should be matched with the bindings of ClusterLightCounts and ClusterLightIndices in the shaders.
+   inline static constexpr GLuint LightCountBindingPoint = 2;
+   inline static constexpr GLuint LightIndexBindingPoint = 3;
+
+   GLuint LightCountBuffer;
+   GLuint LightIndexBuffer;
+};
\ No newline at end of file
@@ -73,6 +73,13 @@ public:
    [[nodiscard]] GLsizei getIndexNum() const { return static_cast<GLsizei>(IndexBuffer.size()); }
    [[nodiscard]] GLuint getTextureID(int index) const { return TextureID[index]; }
    [[nodiscard]] int getTextureNum() const { return static_cast<int>(TextureID.size()); }
+   [[nodiscard]] const glm::vec4& getEmissionColor() const { return EmissionColor; }
+   [[nodiscard]] const glm::vec4& getAmbientReflectionColor() const { return AmbientReflectionColor; }
+   [[nodiscard]] const glm::vec4& getDiffuseReflectionColor() const { return DiffuseReflectionColor; }
+   [[nodiscard]] const glm::vec4& getSpecularReflectionColor() const { return SpecularReflectionColor; }
+   [[nodiscard]] float getSpecularReflectionExponent() const { return SpecularReflectionExponent; }
+   [[nodiscard]] const glm::vec3& getBoundingBoxMin() const { return BoundingBoxMin; }
+   [[nodiscard]] const glm::vec3& getBoundingBoxMax() const { return BoundingBoxMax; }
    [[nodiscard]] GLuint getCustomBufferID(const std::string& name) const
    {
       const auto it = CustomBuffers.find( name );
@@ -104,6 +111,8 @@ protected:
    glm::vec4 DiffuseReflectionColor; // the intrinsic color
    glm::vec4 SpecularReflectionColor;
    float SpecularReflectionExponent;
+   glm::vec3 BoundingBoxMin;
+   glm::vec3 BoundingBoxMax;
 
    [[nodiscard]] bool prepareTexture2DUsingFreeImage(const std::string& file_path, bool is_grayscale) const;
    void prepareNormal() const;
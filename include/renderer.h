@@ -9,6 +9,12 @@
 #include "base.h"
 #include "text.h"
 #include "light.h"
+#include "timer.h"
+#include "sat.h"
+#include "depth_bounds.h"
+#include "light_cluster.h"
+#include "shadow_atlas.h"
+#include "shader_variant_cache.h"
 
 class RendererGL final
 {
@@ -22,18 +28,105 @@ public:
    RendererGL& operator=(const RendererGL&&) = delete;
 
    void play();
+   [[nodiscard]] static bool validateSummedAreaTableOnGPU();
+   void setShadowMapSize(int size);
+   void setSplitNum(int split_num);
+   void setCascadeAtlas(bool use_atlas);
+   void setShadowedLights(bool use_shadowed_lights);
+   void setClusteredLights(bool use_clustered_lights);
+   void setFrameTimeBudget(double budget_in_milliseconds);
+   void setShadowQualityGovernor(bool use_governor);
 
 private:
-   enum class ALGORITHM_TO_COMPARE { PCF = 0, VSM, PSVSM, SATVSM };
+   enum class ALGORITHM_TO_COMPARE { PCF = 0, VSM, PSVSM, SATVSM, EVSM, OVSM };
+   enum class MOMENTS_PRECISION { RG32F = 0, RG16F, RG16 };
+   using UNIFORM = ShaderGL::UNIFORM;
+
+   // everything the light view passes depend on. the passes are skipped while it stays the same.
+   struct ShadowMapState
+   {
+      bool IsValid;
+      ALGORITHM_TO_COMPARE Algorithm;
+      GLenum MomentsFormat;
+      int ShadowMapSize;
+      int BlurRadius;
+      bool UseLayeredCascades;
+      bool UseIntegerSAT;
+      bool UseCascadeSAT;
+      bool UseShadowedLights;
+      std::vector<glm::mat4> LightViewProjectionMatrices;
+      std::vector<glm::mat4> ObjectTransforms;
+
+      ShadowMapState() :
+         IsValid( false ), Algorithm( ALGORITHM_TO_COMPARE::PCF ), MomentsFormat( 0 ), ShadowMapSize( 0 ),
+         BlurRadius( 0 ), UseLayeredCascades( false ), UseIntegerSAT( false ), UseCascadeSAT( false ),
+         UseShadowedLights( false ) {}
+
+      [[nodiscard]] bool operator==(const ShadowMapState& other) const
+      {
+         return IsValid && other.IsValid && Algorithm == other.Algorithm && MomentsFormat == other.MomentsFormat &&
+            ShadowMapSize == other.ShadowMapSize && BlurRadius == other.BlurRadius &&
+            UseLayeredCascades == other.UseLayeredCascades && UseIntegerSAT == other.UseIntegerSAT &&
+            UseCascadeSAT == other.UseCascadeSAT && UseShadowedLights == other.UseShadowedLights &&
+            LightViewProjectionMatrices == other.LightViewProjectionMatrices &&
+            ObjectTransforms == other.ObjectTransforms;
+      }
+   };
+
+   // it follows the std140 layout of MateralInfo in the scene shaders.
+   struct MaterialInfo
+   {
+      glm::vec4 EmissionColor;
+      glm::vec4 AmbientColor;
+      glm::vec4 DiffuseColor;
+      glm::vec4 SpecularColor;
+      float SpecularExponent;
+      std::array<float, 3> Padding;
+   };
+
+   // the parameters the governor trades for the frame time, from the cheapest to the finest.
+   struct ShadowQualityLevel
+   {
+      int ShadowMapSize;
+      int SplitNum;
+      int PCFMaxFilterSize;
+      int SATMaxFilterSize;
+      int CascadeUpdateInterval;
+   };
 
    inline static RendererGL* Renderer = nullptr;
    GLFWwindow* Window;
    bool Pause;
+   bool UseLayeredCascades;
+   bool UseShadowCache;
+   bool UseEVSMPositiveOnly;
+   bool UseDeferredShading;
+   bool UseShadowQualityGovernor;
+   bool UseIntegerSAT;
+   bool UseCascadeSAT;
+   bool UseTextureGather;
+   bool UseSampleDistribution;
+   bool UseCascadeAtlas;
+   bool UseShadowedLights;
+   bool UseClusteredLights;
    int FrameWidth;
    int FrameHeight;
    int ShadowMapSize;
    int ActiveLightIndex;
    int SplitNum;
+   int BlurRadius;
+   int ClusteredLightNum;
+   uint ShadowCacheQueryNum;
+   uint ShadowCacheHitNum;
+   uint FrameIndex;
+   int CascadeUpdateInterval;
+   int PCFMaxFilterSize;
+   int SATMaxFilterSize;
+   int ShadowQualityLevelIndex;
+   int GovernorCooldownFrameNum;
+   int OverBudgetFrameNum;
+   int UnderBudgetFrameNum;
+   double FrameTimeBudget;
    float BoxHalfSide;
    GLuint DepthFBO;
    GLuint DepthTextureID;
@@ -41,65 +134,282 @@ private:
    GLuint MomentsTextureID;
    GLuint MomentsLayerFBO;
    GLuint MomentsTextureArrayID;
-   GLuint SATTextureID;
+   GLuint MomentsLayeredFBO;
+   GLuint DepthTextureArrayID;
+   GLuint BlurTextureID;
+   GLuint IntegerSATTextureID;
+   GLuint MomentsAtlasFBO;
+   GLuint MomentsAtlasTextureID;
+   GLuint DepthAtlasTextureID;
+   GLuint MomentsCubeFBO;
+   GLuint MomentsCubeTextureID;
+   GLuint DepthCubeTextureID;
+   std::array<GLuint, 6> MomentsCubeFaceViewIDs;
+   GLuint ShadowAtlasFBO;
+   GLuint ShadowAtlasTextureID;
+   GLuint ShadowAtlasDepthTextureID;
+   GLuint GBufferFBO;
+   GLuint SceneDepthFBO;
+   GLuint GBufferDepthTextureID;
+   GLuint GBufferNormalTextureID;
+   GLuint GBufferMaterialTextureID;
+   GLuint FullScreenVAO;
+   GLuint MaterialUBO;
+   GLenum MomentsFormat;
    glm::ivec2 ClickedPoint;
+   glm::ivec2 CascadeAtlasSize;
    std::unique_ptr<TextGL> Texter;
    std::unique_ptr<CameraGL> MainCamera;
    std::unique_ptr<CameraGL> TextCamera;
    std::unique_ptr<CameraGL> LightCamera;
+   std::unique_ptr<ShaderVariantCacheGL> ShaderVariants;
    std::unique_ptr<ShaderGL> TextShader;
-   std::unique_ptr<ShaderGL> PCFSceneShader;
+   ShaderGL* PCFSceneShader;
    std::unique_ptr<ShaderGL> VSMSceneShader;
-   std::unique_ptr<ShaderGL> PSVSMSceneShader;
+   ShaderGL* PSVSMSceneShader;
    std::unique_ptr<ShaderGL> SATVSMSceneShader;
+   std::unique_ptr<ShaderGL> EVSMSceneShader;
+   std::unique_ptr<ShaderGL> OVSMSceneShader;
+   ShaderGL* DeferredPCFSceneShader;
+   std::unique_ptr<ShaderGL> DeferredVSMSceneShader;
+   ShaderGL* DeferredPSVSMSceneShader;
+   std::unique_ptr<ShaderGL> DeferredSATVSMSceneShader;
+   std::unique_ptr<ShaderGL> DeferredEVSMSceneShader;
+   std::unique_ptr<ShaderGL> DeferredOVSMSceneShader;
+   std::unique_ptr<ShaderGL> ShadowedLightsSceneShader;
+   std::unique_ptr<ShaderGL> DeferredShadowedLightsSceneShader;
+   ShaderGL* ClusteredLightsSceneShader;
+   ShaderGL* DeferredClusteredLightsSceneShader;
+   std::unique_ptr<ShaderGL> GBufferShader;
    std::unique_ptr<ShaderGL> LightViewDepthShader;
    std::unique_ptr<ShaderGL> LightViewMomentsShader;
-   std::unique_ptr<ShaderGL> LightViewMomentsArrayShader;
+   std::unique_ptr<ShaderGL> LightViewDistanceMomentsShader;
+   ShaderGL* LightViewMomentsArrayShader;
+   ShaderGL* LightViewMomentsLayeredShader;
+   std::unique_ptr<ShaderGL> LightViewExponentialMomentsShader;
+   std::unique_ptr<ShaderGL> LightViewCubeMomentsShader;
    std::unique_ptr<ShaderGL> SATShader;
+   std::unique_ptr<ShaderGL> IntegerSATShader;
+   std::unique_ptr<ShaderGL> CascadeSATShader;
+   std::unique_ptr<ShaderGL> MomentsBlurShader;
+   std::unique_ptr<ShaderGL> DepthBoundsShader;
+   std::unique_ptr<ShaderGL> LightCullingShader;
    std::unique_ptr<LightGL> Lights;
+   std::unique_ptr<LightGL> ClusteredLights;
    std::unique_ptr<ObjectGL> Object;
    std::unique_ptr<ObjectGL> WallObject;
+   std::unique_ptr<TimerGL> LightPassTimer;
+   std::unique_ptr<TimerGL> ScenePassTimer;
+   std::unique_ptr<DepthBoundsGL> SceneDepthBounds;
+   std::unique_ptr<LightClusterGL> LightClusters;
+   std::unique_ptr<ShadowAtlas> LightShadowAtlas;
+   std::vector<std::unique_ptr<CameraGL>> ShadowedLightCameras;
+   std::vector<glm::mat4> ShadowedLightMatrices;
+   std::vector<float> ShadowedLightFarPlanes;
+   std::vector<glm::vec4> ShadowedLightTiles;
+   std::vector<std::pair<int, glm::ivec4>> DirtyShadowTiles;
+   std::vector<glm::mat4> ShadowAtlasObjectTransforms;
+   // the light and scene pass times last measured with each algorithm and moments format.
+   std::map<std::pair<ALGORITHM_TO_COMPARE, GLenum>, std::pair<double, double>> ShadowPassTimes;
+   std::vector<glm::mat4> ObjectTransforms;
    std::vector<float> SplitPositions;
+   std::vector<glm::mat4> PointLightFaceMatrices;
+   float PointLightFarPlane;
+   std::vector<glm::ivec4> CascadeAtlasTiles;
    std::vector<glm::mat4> LightViewProjectionMatrices;
+   std::vector<glm::mat4> RenderedLightViewProjectionMatrices;
    ALGORITHM_TO_COMPARE AlgorithmToCompare;
+   MOMENTS_PRECISION MomentsPrecision;
+   ShadowMapState CachedShadowMapState;
 
    // 16 and 32 do well, anything in between or below is bad.
    // 32 seems to do well on laptop/desktop Windows Intel and on NVidia/AMD as well.
    // further hardware-specific tuning might be needed for optimal performance.
+   // sat_generator.comp is built with it as TILE_SIZE.
    static constexpr int ThreadGroupSize = 32;
    [[nodiscard]] static int getGroupSize(int size)
    {
       return (size + ThreadGroupSize - 1) / ThreadGroupSize;
    }
 
+   // moments_blur.comp is built with them as MAX_RADIUS and GROUP_SIZE.
+   static constexpr int MaxBlurRadius = 16;
+   static constexpr int BlurGroupSize = 256;
+   [[nodiscard]] static int getMipLevelNum(int size)
+   {
+      return static_cast<int>(std::floor( std::log2( static_cast<float>(size) ) )) + 1;
+   }
+
+   // the light view covers the same area in the world for every resolution, so only the texel density changes.
+   static constexpr int LightViewExtent = 1024;
+   static constexpr int MinShadowMapSize = 256;
+   static constexpr int MaxShadowMapSize = 8192;
+
+   // the point light follows the sun in the lights, and each face of its cube map has the shadow map size.
+   static constexpr int PointLightIndex = 1;
+   static constexpr float PointLightNearPlane = 1.0f;
+
+   // the cascade shaders are rebuilt with SPLIT_NUM, and every split needs its own color attachment.
+   static constexpr int MaxSplitNum = 8;
+
+   // the shadowed lights share one atlas of a fixed size, and each of them takes a tile between these sizes.
+   // MaxShadowedLightNum should not exceed MAX_LIGHTS of the scene shaders, which is the maximum of LightGL.
+   static constexpr int ShadowAtlasSize = 4096;
+   static constexpr int MaxLightTileSize = 1024;
+   static constexpr int MinLightTileSize = 128;
+   static constexpr int MaxShadowedLightNum = 32;
+
+   // each farther split of the atlas halves the resolution of the previous one, but not below this size.
+   static constexpr int MinCascadeTileSize = 64;
+
+   // the depth bounds are one frame old, so they are widened a little for the camera moving in the meantime.
+   static constexpr float DepthBoundsMargin = 0.05f;
+
+   // the clustered lights are small point lights without shadows, and their number doubles up to the maximum.
+   static constexpr int MinClusteredLightNum = 256;
+   static constexpr int MaxClusteredLightNum = 4096;
+   static constexpr float ClusteredLightFallOffRadius = 6.0f;
+
+   // the quality drops as soon as the budget is exceeded for a few frames, but it rises only after a long while
+   // well under the budget, so the governor does not oscillate between two neighboring levels.
+   static constexpr double OverBudgetRatio = 1.05;
+   static constexpr double UnderBudgetRatio = 0.7;
+   static constexpr int OverBudgetFrameThreshold = 8;
+   static constexpr int UnderBudgetFrameThreshold = 90;
+   static constexpr int GovernorCooldownFrames = 30;
+
+   // the sat filter has no limit of its own at this size, so it is only bounded by the shadow map.
+   static constexpr int UnlimitedFilterSize = 0;
+   static constexpr std::array<ShadowQualityLevel, 5> ShadowQualityLevels = { {
+      { 512, 1, 4, 16, 8 },
+      { 1024, 2, 8, 64, 4 },
+      { 1024, 3, 16, 256, 2 },
+      { 2048, 3, 24, 1024, 1 },
+      { 4096, 3, 32, UnlimitedFilterSize, 1 }
+   } };
+
+   // the moments are stored as the deviations from their mean with 15 fractional bits, so a tile of 2^16 texels
+   // sums to less than 2^31 in magnitude only while its deviations stay below 1. the moments lie in [0, 1], so a
+   // deviation reaches -1 only at the mean of 1 and +1 only at the mean of 0, where every moment is 0.
+   // a tile full of ones lifts the mean above 0 by 2^16 texels, so the area sums of the filter up to 256 texels
+   // stay in the signed 32 bits that the unsigned texels wrap around.
+   static constexpr int IntegerSATFractionBits = 15;
+   static constexpr int IntegerSATMaxFilterSize = 256;
+
+   // exp(2c) of the second moment should stay below the largest half float, 65504, so c is at most 5.54.
+   static constexpr float EVSMPositiveExponent = 5.0f;
+   static constexpr float EVSMNegativeExponent = 5.0f;
+
+   // the scene shaders are built with it as MAX_MATERIALS, and the binding should be matched with MaterialBlock.
+   static constexpr int MaxMaterialNum = 8;
+   static constexpr GLuint MaterialBindingPoint = 1;
+   static constexpr GLuint ObjectMaterialID = 0;
+   static constexpr GLuint WallMaterialID = 1;
+
+   // the tuning constants of the scene shaders, which are defined in every variant of them.
+   // the shadow maps are not sampled within the border from their edges, which is wider for the sat filters.
+   static constexpr float ShadowMapBorder = 1e-2f;
+   static constexpr float SATShadowMapBorder = 1e-1f;
+   static constexpr float SATMinVariance = 3e-4f;
+   static constexpr float LightBleedingReduction = 0.18f;
+   static constexpr float PCFDepthBias = 0.005f;
+
    void registerCallbacks() const;
    void initialize();
    void writeFrame() const;
    void writeSATTexture() const;
+   void validateSummedAreaTable();
+   [[nodiscard]] static bool checkSummedAreaTable(
+      const std::vector<float>& moments,
+      int size,
+      int max_filter_size,
+      GLuint moments_texture_id,
+      GLuint integer_sat_texture_id
+   );
    void writeMomentsArrayTexture() const;
    static void printOpenGLInformation();
+   [[nodiscard]] static bool isSubgroupScanSupported();
+   [[nodiscard]] static ShaderGL::DefineSet getSATShaderDefines();
+   [[nodiscard]] static int getBytesPerTexel(GLenum format);
+   [[nodiscard]] static std::string getFormatString(GLenum format);
    static void cleanup(GLFWwindow* window);
    static void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods);
    static void cursor(GLFWwindow* window, double xpos, double ypos);
    static void mouse(GLFWwindow* window, int button, int action, int mods);
    static void mousewheel(GLFWwindow* window, double xoffset, double yoffset);
 
+   [[nodiscard]] static ShaderGL::DefineSet getSceneShaderDefines();
+   [[nodiscard]] ShaderGL* getPCFSceneShader(int max_filter_size, bool deferred_shading);
+   void setPCFShaders();
+   void setCascadeShaders();
+   void setClusteredLightsShaders();
+   void setClusteredLightSources();
    void setLights() const;
-   void setObject() const;
+   void setObject();
    void setWallObject() const;
    void setLightViewFrameBuffers();
+   void setCascadeAtlasFrameBuffer();
+   void deleteLightViewFrameBuffers();
+   void setMomentsCubeFrameBuffer();
+   void deleteMomentsCubeFrameBuffer();
+   void setGeometryBuffers();
+   void deleteGeometryBuffers();
+   void setAlgorithmToCompare(ALGORITHM_TO_COMPARE algorithm);
+   void setShadowAtlas();
+   void deleteShadowAtlas();
+   void setShadowedLightCameras();
+   void setMaterialBuffer();
+   [[nodiscard]] static MaterialInfo getMaterialInfo(const ObjectGL* object);
+   [[nodiscard]] GLenum getMomentsFormat() const;
+   [[nodiscard]] float getMinVariance() const;
+   [[nodiscard]] size_t getShadowMapMemorySize(GLenum moments_format) const;
+   [[nodiscard]] size_t getCascadeTexelNum() const;
+   [[nodiscard]] size_t getAlgorithmMemorySize(ALGORITHM_TO_COMPARE algorithm, GLenum moments_format) const;
+   void getSceneBoundingBox(glm::vec3& min_point, glm::vec3& max_point) const;
+   void fitLightDepthRangeToScene(CameraGL* camera) const;
+   [[nodiscard]] int getShadowedLightTileSize(int light_index, float max_luminance) const;
+   void updateShadowedLights();
+   void updatePointLightFaces();
+   [[nodiscard]] int getPointLightFaceMask(const ObjectGL* object, const glm::mat4& to_world) const;
+   void cullClusteredLights() const;
+   [[nodiscard]] ShadowMapState getShadowMapState() const;
+   [[nodiscard]] int getSATMaxFilterSize(bool is_integer_table) const;
    void drawObject(ShaderGL* shader, CameraGL* camera) const;
    void drawBoxObject(ShaderGL* shader, const CameraGL* camera) const;
    void drawDepthMapFromLightView() const;
    void drawMomentsMapFromLightView() const;
-   void drawMomentsArrayMapFromLightView() const;
+   void drawMomentsArrayMapFromLightView(int split_mask) const;
+   void drawMomentsArrayMapFromLightViewInSinglePass(int split_mask) const;
+   void drawMomentsAtlasFromLightView(int split_mask) const;
+   void drawShadowAtlasFromLights() const;
+   void drawExponentialMomentsMapFromLightView() const;
+   void drawMomentsCubeMapFromPointLight() const;
+   void blurMomentsTexture(GLuint moments_texture_id) const;
+   void filterMomentsMap() const;
+   void filterMomentsCubeMap() const;
    void splitViewFrustum();
    void calculateLightCropMatrices();
+   [[nodiscard]] int scheduleCascadeUpdates(bool is_state_changed);
+   void applyShadowQualityLevel(int level_index);
+   void governShadowQuality();
+   static void dispatchSummedAreaTable(
+      ShaderGL* shader,
+      int size,
+      GLuint moments_texture_id,
+      GLuint integer_sat_texture_id
+   );
    void generateSummedAreaTable() const;
+   void generateCascadeSummedAreaTables(int split_mask) const;
+   void drawGeometryBuffers() const;
+   void drawSceneDepth() const;
+   void reduceSceneDepth() const;
+   void drawScene(ShaderGL* shader) const;
    void drawShadowWithPCF() const;
    void drawShadowWithVSM() const;
    void drawShadowWithPSVSM() const;
    void drawShadowWithSATVSM() const;
+   void drawShadowWithEVSM() const;
+   void drawShadowWithOVSM() const;
    void drawText(const std::string& text, glm::vec2 start_position) const;
    void render();
 };
\ No newline at end of file
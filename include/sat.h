@@ -0,0 +1,66 @@
+#pragma once
+
+#include "base.h"
+
+// the cpu counterpart of sat_generator.comp, which builds the same tables without any gpu.
+// the moments are interleaved as rg pairs in the rows from the bottom, just like the texture images read back.
+class SummedAreaTable final
+{
+public:
+   explicit SummedAreaTable(int thread_num = 0);
+   ~SummedAreaTable() = default;
+
+   SummedAreaTable(const SummedAreaTable&) = delete;
+   SummedAreaTable(const SummedAreaTable&&) = delete;
+   SummedAreaTable& operator=(const SummedAreaTable&) = delete;
+   SummedAreaTable& operator=(const SummedAreaTable&&) = delete;
+
+   void build(std::vector<float>& moments, int size) const;
+   void build(std::vector<uint32_t>& moments, int size) const;
+   [[nodiscard]] int getThreadNum() const { return ThreadNum; }
+   [[nodiscard]] static std::string getInstructionSetName();
+   [[nodiscard]] static glm::vec2 getMean(const std::vector<float>& moments);
+   [[nodiscard]] static std::vector<uint32_t> getFixedPointMoments(
+      const std::vector<float>& moments,
+      const glm::vec2& mean,
+      int fraction_bits
+   );
+   [[nodiscard]] static std::vector<double> getReferenceTable(const std::vector<float>& moments, int size);
+   [[nodiscard]] static double getMaxAreaError(
+      const std::vector<float>& table,
+      const std::vector<double>& reference,
+      int size,
+      int max_filter_size,
+      int min_filter_size = 1
+   );
+   [[nodiscard]] static double getMaxAreaError(
+      const std::vector<uint32_t>& table,
+      const std::vector<double>& reference,
+      int size,
+      int max_filter_size,
+      const glm::vec2& mean,
+      int fraction_bits,
+      int min_filter_size = 1
+   );
+   [[nodiscard]] static double getFloatErrorBound(int size, int filter_size);
+   static bool validate();
+   static void benchmark(int max_size);
+
+private:
+   // a block of the columns is scanned down by one thread, and 1024 floats of a row stay within a few cache lines.
+   inline static constexpr int ColumnBlockWidth = 1024;
+   inline static constexpr int AreaQueryNum = 4096;
+
+   int ThreadNum;
+
+   void runInParallel(int task_num, const std::function<void(int, int)>& task) const;
+   template<typename T>
+   void buildTable(T* moments, int size) const;
+   [[nodiscard]] static double getMaxAreaError(
+      const std::vector<double>& reference,
+      int size,
+      int max_filter_size,
+      int min_filter_size,
+      const std::function<glm::dvec2(int, int, int, int)>& get_area_sum
+   );
+};
\ No newline at end of file
@@ -6,31 +6,22 @@
 class ShaderGL final
 {
 public:
-   struct LightLocationSet
-   {
-      GLint LightSwitch, LightPosition;
-      GLint LightAmbient, LightDiffuse, LightSpecular, LightFallOffRadius;
-      GLint SpotlightDirection, SpotlightCutoffAngle, SpotlightFeather;
-
-      LightLocationSet() : LightSwitch( 0 ), LightPosition( 0 ), LightAmbient( 0 ), LightDiffuse( 0 ),
-      LightSpecular( 0 ), LightFallOffRadius( 0 ), SpotlightDirection( 0 ), SpotlightCutoffAngle( 0 ),
-      SpotlightFeather( 0 ) {}
+   // the handles of the uniforms, whose locations are resolved once when the program is linked,
+   // so setting a uniform costs no more than the gl call itself.
+   enum class UNIFORM {
+      WorldMatrix = 0, ViewMatrix, ProjectionMatrix, ModelViewProjectionMatrix, InverseViewMatrix,
+      InverseProjectionMatrix, LightViewProjectionMatrix, ShadowedLightMatrices, ShadowedLightFarPlanes,
+      MaterialEmissionColor, MaterialAmbientColor, MaterialDiffuseColor, MaterialSpecularColor,
+      MaterialSpecularExponent, MaterialID, TextScale, TextureIndex, SplitMask, SplitPositions, AtlasTiles,
+      ShadowTiles, Exponents, FaceMask, LightPosition, LightFarPlane, LightIndex, LightNum, MinVariance,
+      MaxFilterSize, Size, Direction, MeanLevel, FixedPointScale, Radius, Weights, ClusterGridSize,
+      ClusterDepthRange, ClusterTileSize, UseSAT, UseIntegerSAT, UseTextureGather, UseNegativeMoments, Count
    };
 
-   struct LocationSet
-   {
-      GLint World, View, Projection, ModelViewProjection;
-      GLint MaterialEmission, MaterialAmbient, MaterialDiffuse, MaterialSpecular, MaterialSpecularExponent;
-      std::map<GLint, GLint> Texture; // <binding point, texture id>
-      GLint UseLight, LightNum, GlobalAmbient;
-      std::vector<LightLocationSet> Lights;
-
-      LocationSet() : World( 0 ), View( 0 ), Projection( 0 ), ModelViewProjection( 0 ), MaterialEmission( 0 ),
-      MaterialAmbient( 0 ), MaterialDiffuse( 0 ), MaterialSpecular( 0 ), MaterialSpecularExponent( 0 ), UseLight( 0 ),
-      LightNum( 0 ), GlobalAmbient( 0 ) {}
-   };
+   // the defines by their names, which are ordered so that the same set always gives the same sources.
+   using DefineSet = std::map<std::string, std::string>;
 
-   ShaderGL();
+   explicit ShaderGL(DefineSet defines = {});
    virtual ~ShaderGL();
 
    void setShader(
@@ -41,120 +32,121 @@ public:
       const char* tessellation_evaluation_shader_path = nullptr
    );
    void setComputeShader(const char* compute_shader_path);
-   void setTextUniformLocations();
-   void setLightViewUniformLocations();
-   void setLightViewArrayUniformLocations();
-   void setSATUniformLocations();
-   void setSceneUniformLocations(int light_num);
-   void setPSSMSceneUniformLocations(int light_num);
-   void addUniformLocation(const std::string& name)
+   static void enableParallelCompile();
+   [[nodiscard]] bool isReady() const;
+   void finish();
+   static void finishAll(const std::vector<ShaderGL*>& shaders);
+   void addDefine(const std::string& name) { Defines[name] = ""; }
+   void addDefine(const std::string& name, int value) { Defines[name] = std::to_string( value ); }
+   void addDefine(const std::string& name, float value) { Defines[name] = getFloatLiteral( value ); }
+   void addDefines(const DefineSet& defines)
    {
-      CustomLocations[name] = glGetUniformLocation( ShaderProgram, name.c_str() );
+      for (const auto& define : defines) Defines[define.first] = define.second;
    }
    void transferBasicTransformationUniforms(const glm::mat4& to_world, const CameraGL* camera) const;
-   void uniform1i(const char* name, int value) const
-   {
-      glProgramUniform1i( ShaderProgram, CustomLocations.find( name )->second, value );
-   }
-   void uniform1ui(const char* name, uint value) const
-   {
-      glProgramUniform1ui( ShaderProgram, CustomLocations.find( name )->second, value );
-   }
-   void uniform1f(const char* name, float value) const
-   {
-      glProgramUniform1f( ShaderProgram, CustomLocations.find( name )->second, value );
-   }
-   void uniform1fv(const char* name, int count, const float* value) const
-   {
-      glProgramUniform1fv( ShaderProgram, CustomLocations.find( name )->second, count, value );
-   }
-   void uniform2iv(const char* name, const glm::ivec2& value) const
-   {
-      glProgramUniform2iv( ShaderProgram, CustomLocations.find( name )->second, 1, &value[0] );
-   }
-   void uniform2fv(const char* name, const glm::vec2& value) const
+   void uniform1i(UNIFORM uniform, int value) const
    {
-      glProgramUniform2fv( ShaderProgram, CustomLocations.find( name )->second, 1, &value[0] );
+      glProgramUniform1i( ShaderProgram, getLocation( uniform ), value );
    }
-   void uniform2fv(const char* name, int count, const float* value) const
+   void uniform1ui(UNIFORM uniform, uint value) const
    {
-      glProgramUniform2fv( ShaderProgram, CustomLocations.find( name )->second, count, value );
+      glProgramUniform1ui( ShaderProgram, getLocation( uniform ), value );
    }
-   void uniform3fv(const char* name, const glm::vec3& value) const
+   void uniform1f(UNIFORM uniform, float value) const
    {
-      glProgramUniform3fv( ShaderProgram, CustomLocations.find( name )->second, 1, &value[0] );
+      glProgramUniform1f( ShaderProgram, getLocation( uniform ), value );
    }
-   void uniform4fv(const char* name, const glm::vec4& value) const
+   void uniform1fv(UNIFORM uniform, int count, const float* value) const
    {
-      glProgramUniform4fv( ShaderProgram, CustomLocations.find( name )->second, 1, &value[0] );
+      glProgramUniform1fv( ShaderProgram, getLocation( uniform ), count, value );
    }
-   void uniformMat3fv(const char* name, const glm::mat3& value) const
+   void uniform2iv(UNIFORM uniform, const glm::ivec2& value) const
    {
-      glProgramUniformMatrix3fv( ShaderProgram, CustomLocations.find( name )->second, 1, GL_FALSE, &value[0][0] );
+      glProgramUniform2iv( ShaderProgram, getLocation( uniform ), 1, &value[0] );
    }
-   void uniformMat4fv(const char* name, const glm::mat4& value) const
+   void uniform3iv(UNIFORM uniform, const glm::ivec3& value) const
    {
-      glProgramUniformMatrix4fv( ShaderProgram, CustomLocations.find( name )->second, 1, GL_FALSE, &value[0][0] );
+      glProgramUniform3iv( ShaderProgram, getLocation( uniform ), 1, &value[0] );
    }
-   void uniformMat4fv(const char* name, const std::vector<glm::mat4>& value) const
-   {
-      glProgramUniformMatrix4fv( ShaderProgram, CustomLocations.find( name )->second, value.size(), GL_FALSE, &value[0][0][0] );
-   }
-   [[nodiscard]] GLuint getShaderProgram() const { return ShaderProgram; }
-   [[nodiscard]] GLint getLocation(const std::string& name) const { return CustomLocations.find( name )->second; }
-   [[nodiscard]] GLint getMaterialEmissionLocation() const { return Location.MaterialEmission; }
-   [[nodiscard]] GLint getMaterialAmbientLocation() const { return Location.MaterialAmbient; }
-   [[nodiscard]] GLint getMaterialDiffuseLocation() const { return Location.MaterialDiffuse; }
-   [[nodiscard]] GLint getMaterialSpecularLocation() const { return Location.MaterialSpecular; }
-   [[nodiscard]] GLint getMaterialSpecularExponentLocation() const { return Location.MaterialSpecularExponent; }
-   [[nodiscard]] GLint getLightAvailabilityLocation() const { return Location.UseLight; }
-   [[nodiscard]] GLint getLightNumLocation() const { return Location.LightNum; }
-   [[nodiscard]] GLint getGlobalAmbientLocation() const { return Location.GlobalAmbient; }
-   [[nodiscard]] GLint getLightSwitchLocation(int light_index) const
+   void uniform2fv(UNIFORM uniform, const glm::vec2& value) const
    {
-      return Location.Lights[light_index].LightSwitch;
+      glProgramUniform2fv( ShaderProgram, getLocation( uniform ), 1, &value[0] );
    }
-   [[nodiscard]] GLint getLightPositionLocation(int light_index) const
+   void uniform2fv(UNIFORM uniform, int count, const float* value) const
    {
-      return Location.Lights[light_index].LightPosition;
+      glProgramUniform2fv( ShaderProgram, getLocation( uniform ), count, value );
    }
-   [[nodiscard]] GLint getLightAmbientLocation(int light_index) const
+   void uniform3fv(UNIFORM uniform, const glm::vec3& value) const
    {
-      return Location.Lights[light_index].LightAmbient;
+      glProgramUniform3fv( ShaderProgram, getLocation( uniform ), 1, &value[0] );
    }
-   [[nodiscard]] GLint getLightDiffuseLocation(int light_index) const
+   void uniform4fv(UNIFORM uniform, const glm::vec4& value) const
    {
-      return Location.Lights[light_index].LightDiffuse;
+      glProgramUniform4fv( ShaderProgram, getLocation( uniform ), 1, &value[0] );
    }
-   [[nodiscard]] GLint getLightSpecularLocation(int light_index) const
+   void uniform4fv(UNIFORM uniform, int count, const float* value) const
    {
-      return Location.Lights[light_index].LightSpecular;
+      glProgramUniform4fv( ShaderProgram, getLocation( uniform ), count, value );
    }
-   [[nodiscard]] GLint getLightSpotlightDirectionLocation(int light_index) const
+   void uniformMat3fv(UNIFORM uniform, const glm::mat3& value) const
    {
-      return Location.Lights[light_index].SpotlightDirection;
+      glProgramUniformMatrix3fv( ShaderProgram, getLocation( uniform ), 1, GL_FALSE, &value[0][0] );
    }
-   [[nodiscard]] GLint getLightSpotlightCutoffAngleLocation(int light_index) const
+   void uniformMat4fv(UNIFORM uniform, const glm::mat4& value) const
    {
-      return Location.Lights[light_index].SpotlightCutoffAngle;
+      glProgramUniformMatrix4fv( ShaderProgram, getLocation( uniform ), 1, GL_FALSE, &value[0][0] );
    }
-   [[nodiscard]] GLint getLightSpotlightFeatherLocation(int light_index) const
+   void uniformMat4fv(UNIFORM uniform, const std::vector<glm::mat4>& value) const
    {
-      return Location.Lights[light_index].SpotlightFeather;
+      glProgramUniformMatrix4fv( ShaderProgram, getLocation( uniform ), value.size(), GL_FALSE, &value[0][0][0] );
    }
-   [[nodiscard]] GLint getLightFallOffRadiusLocation(int light_index) const
+   [[nodiscard]] static std::string getFloatLiteral(float value);
+   [[nodiscard]] GLuint getShaderProgram() const { return ShaderProgram; }
+   [[nodiscard]] GLint getLocation(UNIFORM uniform) const { return Locations[static_cast<size_t>(uniform)]; }
+   [[nodiscard]] GLint getMaterialEmissionLocation() const { return getLocation( UNIFORM::MaterialEmissionColor ); }
+   [[nodiscard]] GLint getMaterialAmbientLocation() const { return getLocation( UNIFORM::MaterialAmbientColor ); }
+   [[nodiscard]] GLint getMaterialDiffuseLocation() const { return getLocation( UNIFORM::MaterialDiffuseColor ); }
+   [[nodiscard]] GLint getMaterialSpecularLocation() const { return getLocation( UNIFORM::MaterialSpecularColor ); }
+   [[nodiscard]] GLint getMaterialSpecularExponentLocation() const
    {
-      return Location.Lights[light_index].LightFallOffRadius;
+      return getLocation( UNIFORM::MaterialSpecularExponent );
    }
 
 protected:
+   // the stages of a program as their types and their sources with the defines already inserted.
+   using ShaderSources = std::vector<std::pair<GLenum, std::string>>;
+
+   // the header of a cached program binary, which is followed by the binary itself.
+   struct ProgramBinaryHeader
+   {
+      uint64_t Key;
+      GLenum Format;
+      GLsizei Length;
+   };
+
+   // the core profile header does not have KHR_parallel_shader_compile, so its token is defined here.
+   inline static constexpr GLenum CompletionStatus = 0x91B1;
+   inline static bool ParallelCompileSupported = false;
+
    GLuint ShaderProgram;
-   LocationSet Location;
-   std::unordered_map<std::string, GLint> CustomLocations;
+   uint64_t PendingKey;
+   ShaderSources PendingSources;
+   std::vector<GLuint> PendingShaders;
+   std::array<GLint, static_cast<size_t>(UNIFORM::Count)> Locations;
+   DefineSet Defines;
 
    static void readShaderFile(std::string& shader_contents, const char* shader_path);
    [[nodiscard]] static std::string getShaderTypeString(GLenum shader_type);
    [[nodiscard]] static bool checkCompileError(GLenum shader_type, const GLuint& shader);
-   [[nodiscard]] static GLuint getCompiledShader(GLenum shader_type, const char* shader_path);
-   void setBasicTransformationUniforms();
+   [[nodiscard]] bool checkLinkError() const;
+   [[nodiscard]] std::string getDefineBlock() const;
+   void addShaderSource(ShaderSources& sources, GLenum shader_type, const char* shader_path) const;
+   [[nodiscard]] static GLuint getSubmittedShader(GLenum shader_type, const std::string& shader_source);
+   [[nodiscard]] static uint64_t getProgramKey(const ShaderSources& sources);
+   [[nodiscard]] static std::string getProgramCachePath(uint64_t key);
+   [[nodiscard]] bool loadProgramBinary(const std::string& cache_path, uint64_t key) const;
+   void saveProgramBinary(const std::string& cache_path, uint64_t key) const;
+   void setProgram(const ShaderSources& sources);
+   [[nodiscard]] static const std::unordered_map<std::string, UNIFORM>& getUniformHandles();
+   void setUniformLocations();
 };
\ No newline at end of file
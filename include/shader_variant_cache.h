@@ -0,0 +1,36 @@
+#pragma once
+
+#include "shader.h"
+
+// the programs built from the same sources with different sets of defines. a variant is built once and kept,
+// so switching back to a configuration used before compiles nothing.
+class ShaderVariantCacheGL final
+{
+public:
+   ShaderVariantCacheGL() = default;
+   ~ShaderVariantCacheGL() = default;
+
+   ShaderVariantCacheGL(const ShaderVariantCacheGL&) = delete;
+   ShaderVariantCacheGL(const ShaderVariantCacheGL&&) = delete;
+   ShaderVariantCacheGL& operator=(const ShaderVariantCacheGL&) = delete;
+   ShaderVariantCacheGL& operator=(const ShaderVariantCacheGL&&) = delete;
+
+   // a new variant is only submitted, so it should be finished before its uniforms are set.
+   [[nodiscard]] ShaderGL* getShader(
+      const ShaderGL::DefineSet& defines,
+      const std::string& vertex_shader_path,
+      const std::string& fragment_shader_path,
+      const std::string& geometry_shader_path = ""
+   );
+   [[nodiscard]] int getVariantNum() const { return static_cast<int>(Variants.size()); }
+
+private:
+   std::unordered_map<std::string, std::unique_ptr<ShaderGL>> Variants;
+
+   [[nodiscard]] static std::string getVariantKey(
+      const ShaderGL::DefineSet& defines,
+      const std::string& vertex_shader_path,
+      const std::string& fragment_shader_path,
+      const std::string& geometry_shader_path
+   );
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "base.h"
+
+// a quadtree allocator of the square power-of-two tiles in a shadow atlas. the tile of a light is kept
+// while the light asks for the same size, and it is rendered again only when the view of the light changes.
+// the least recently used tiles are evicted when the atlas runs out of space.
+class ShadowAtlas final
+{
+public:
+   ShadowAtlas(int atlas_size, int min_tile_size);
+   ~ShadowAtlas() = default;
+
+   ShadowAtlas(const ShadowAtlas&) = delete;
+   ShadowAtlas(const ShadowAtlas&&) = delete;
+   ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+   ShadowAtlas& operator=(const ShadowAtlas&&) = delete;
+
+   void beginFrame() { FrameIndex++; }
+   [[nodiscard]] bool acquire(
+      int owner,
+      int tile_size,
+      const glm::mat4& view_projection,
+      glm::ivec4& tile,
+      bool& is_dirty
+   );
+   void release(int owner);
+   void invalidate();
+   [[nodiscard]] int getAtlasSize() const { return AtlasSize; }
+   [[nodiscard]] int getAllocationNum() const { return static_cast<int>(Allocations.size()); }
+   [[nodiscard]] int getUsedTexelRatioInPercent() const;
+
+private:
+   struct Allocation
+   {
+      glm::ivec2 Position;
+      int Size;
+      uint LastUsedFrame;
+      bool IsValid;
+      glm::mat4 ViewProjection;
+   };
+
+   int AtlasSize;
+   int MinTileSize;
+   uint FrameIndex;
+   std::vector<std::vector<glm::ivec2>> FreeTiles;
+   std::unordered_map<int, Allocation> Allocations;
+
+   [[nodiscard]] int getLevel(int tile_size) const;
+   [[nodiscard]] bool allocate(int level, glm::ivec2& position);
+   void free(int level, const glm::ivec2& position);
+   [[nodiscard]] bool evictLeastRecentlyUsed();
+};
\ No newline at end of file
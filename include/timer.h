@@ -0,0 +1,31 @@
+#pragma once
+
+#include "base.h"
+
+class TimerGL final
+{
+public:
+   TimerGL();
+   ~TimerGL();
+
+   TimerGL(const TimerGL&) = delete;
+   TimerGL(const TimerGL&&) = delete;
+   TimerGL& operator=(const TimerGL&) = delete;
+   TimerGL& operator=(const TimerGL&&) = delete;
+
+   void begin();
+   void end();
+   [[nodiscard]] double getElapsedTimeInMilliseconds() const { return ElapsedTime; }
+
+private:
+   // the results are read a few frames later so that the query never stalls the pipeline.
+   inline static constexpr int QueryFrameNum = 4;
+
+   int Current;
+   bool Recording;
+   double ElapsedTime;
+   std::array<bool, QueryFrameNum> Issued;
+   std::array<GLuint, QueryFrameNum * 2> Queries;
+
+   void collectElapsedTime(int index);
+};
\ No newline at end of file
@@ -1,7 +1,29 @@
 #include "renderer.h"
+#include <charconv>
+#include <string_view>
 
-int main()
+int main(int argc, char** argv)
 {
+   // the summed area tables can be validated and profiled on the cpu without opening any window,
+   // and the compute shaders are validated against them in a hidden one, which a software gl can run as well.
+   const std::string option = argc > 1 ? argv[1] : "";
+   if (option == "--sat-validate") return SummedAreaTable::validate() ? 0 : 1;
+   if (option == "--sat-validate-gpu") return RendererGL::validateSummedAreaTableOnGPU() ? 0 : 1;
+   if (option == "--sat-benchmark") {
+      // the tables double from 1024 up to the given size, and 16384 already needs a few gigabytes.
+      int max_size = 16384;
+      if (argc > 2) {
+         const std::string_view argument = argv[2];
+         const auto [end, error] = std::from_chars( argument.data(), argument.data() + argument.size(), max_size );
+         if (error != std::errc() || end != argument.data() + argument.size() || max_size < 1024 || max_size > 16384) {
+            std::cerr << "usage: " << argv[0] << " --sat-benchmark [max size in 1024..16384]\n";
+            return 1;
+         }
+      }
+      SummedAreaTable::benchmark( max_size );
+      return 0;
+   }
+
    RendererGL renderer;
    renderer.play();
    return 0;
@@ -0,0 +1,10 @@
+#version 460
+
+out vec2 screen_coord;
+
+void main()
+{
+   // a single triangle covering the whole screen is generated from the vertex index without any vertex buffer.
+   screen_coord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   gl_Position = vec4(2.0f * screen_coord - 1.0f, 0.0f, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+// included by the scene shaders of every technique in their deferred variant, after MateralInfo and MAX_MATERIALS.
+// the inputs that the vertex shader gives in the forward variant are rebuilt from the geometry buffers.
+layout (std140, binding = 1) uniform MaterialBlock
+{
+   MateralInfo Materials[MAX_MATERIALS];
+};
+MateralInfo Material;
+
+layout (binding = 1) uniform sampler2D DepthBuffer;
+layout (binding = 2) uniform sampler2D NormalBuffer;
+layout (binding = 3) uniform usampler2D MaterialBuffer;
+
+uniform mat4 InverseViewMatrix;
+uniform mat4 InverseProjectionMatrix;
+
+in vec2 screen_coord;
+
+vec4 position_in_wc;
+vec3 position_in_ec;
+vec3 normal_in_ec;
+
+vec3 decodeOctahedron(in vec2 encoded)
+{
+   vec3 n = vec3(encoded, 1.0f - abs( encoded.x ) - abs( encoded.y ));
+   float t = max( -n.z, 0.0f );
+   n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+   return normalize( n );
+}
+
+bool readGeometryBuffer()
+{
+   ivec2 pixel = ivec2(gl_FragCoord.xy);
+   float depth = texelFetch( DepthBuffer, pixel, 0 ).r;
+   vec4 position = InverseProjectionMatrix * vec4(2.0f * vec3(screen_coord, depth) - 1.0f, 1.0f);
+   position_in_ec = position.xyz / position.w;
+   position_in_wc = InverseViewMatrix * vec4(position_in_ec, 1.0f);
+   normal_in_ec = decodeOctahedron( texelFetch( NormalBuffer, pixel, 0 ).xy );
+   Material = Materials[min( texelFetch( MaterialBuffer, pixel, 0 ).r, uint(MAX_MATERIALS - 1) )];
+   return depth < 1.0f;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 460
+
+uniform uint MaterialID;
+
+in vec3 normal_in_ec;
+
+layout (location = 0) out vec2 final_normal;
+layout (location = 1) out uint final_material_id;
+
+const float zero = 0.0f;
+const float one = 1.0f;
+
+vec2 encodeOctahedron(in vec3 normal)
+{
+   // the unit sphere is projected onto the octahedron and the lower half is folded over the upper half.
+   vec3 n = normal / (abs( normal.x ) + abs( normal.y ) + abs( normal.z ));
+   vec2 sign_not_zero = vec2(n.x >= zero ? one : -one, n.y >= zero ? one : -one);
+   return n.z >= zero ? n.xy : (one - abs( n.yx )) * sign_not_zero;
+}
+
+void main()
+{
+   final_normal = encodeOctahedron( normalize( normal_in_ec ) );
+   final_material_id = MaterialID;
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 460
+
+uniform mat4 WorldMatrix;
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+uniform mat4 ModelViewProjectionMatrix;
+
+layout (location = 0) in vec3 v_position;
+layout (location = 1) in vec3 v_normal;
+layout (location = 2) in vec2 v_tex_coord;
+
+out vec3 normal_in_ec;
+
+void main()
+{
+   // ViewMatrix * WorldMatrix is rigid body transformation, so it transforms the normals as well.
+   normal_in_ec = (ViewMatrix * WorldMatrix * vec4(v_normal, 0.0f)).xyz;
+   gl_Position = ModelViewProjectionMatrix * vec4(v_position, 1.0f);
+}
\ No newline at end of file
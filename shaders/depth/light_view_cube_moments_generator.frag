@@ -0,0 +1,17 @@
+#version 460
+
+uniform vec3 LightPosition;
+uniform float LightFarPlane;
+
+in vec3 position_in_wc;
+
+layout (location = 0) out vec2 final_moments;
+
+void main()
+{
+   // the distance to the light is the same on both sides of a cube edge, unlike the depth of each face,
+   // so the filtered moments stay continuous across the faces.
+   float distance = length( position_in_wc - LightPosition ) / LightFarPlane;
+   final_moments.r = distance;
+   final_moments.g = distance * distance;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 460
+
+uniform vec2 Exponents;
+
+layout (location = 0) out vec4 final_moments;
+
+void main()
+{
+   // the depth is mapped to [-1, 1] and warped by the positive and negative exponentials.
+   // the negative pair is dropped by the attachment when only the positive moments are stored.
+   float depth = 2.0f * gl_FragCoord.z - 1.0f;
+   float positive = exp( Exponents.x * depth );
+   float negative = -exp( -Exponents.y * depth );
+   final_moments = vec4(positive, positive * positive, negative, negative * negative);
+}
\ No newline at end of file
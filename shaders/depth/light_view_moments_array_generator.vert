@@ -4,7 +4,7 @@ uniform mat4 WorldMatrix;
 uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
 uniform mat4 ModelViewProjectionMatrix;
-uniform mat4 LightViewProjectionMatrix[3];
+uniform mat4 LightViewProjectionMatrix[SPLIT_NUM];
 uniform int TextureIndex;
 
 layout (location = 0) in vec3 v_position;
@@ -1,11 +1,24 @@
 #version 460
 
+#ifdef LIGHT_DISTANCE
+// a light with a perspective view stores its distance normalized by the far plane, which is linear unlike
+// the depth, and a light without any far plane keeps the depth of its orthographic view.
+uniform vec3 LightPosition;
+uniform float LightFarPlane;
+
+in vec3 position_in_wc;
+#endif
+
 layout (location = 0) out vec2 final_moments;
 
 void main()
 {
-   final_moments.r = gl_FragCoord.z;
-   final_moments.g = gl_FragCoord.z * gl_FragCoord.z;
+   float depth = gl_FragCoord.z;
+#ifdef LIGHT_DISTANCE
+   if (LightFarPlane > 0.0f) depth = length( position_in_wc - LightPosition ) / LightFarPlane;
+#endif
+   final_moments.r = depth;
+   final_moments.g = depth * depth;
 
    //float dx = dFdx( gl_FragCoord.z );
    //float dy = dFdy( gl_FragCoord.z );
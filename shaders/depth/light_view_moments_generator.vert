@@ -9,7 +9,14 @@ layout (location = 0) in vec3 v_position;
 layout (location = 1) in vec3 v_normal;
 layout (location = 2) in vec2 v_tex_coord;
 
+#ifdef LIGHT_DISTANCE
+out vec3 position_in_wc;
+#endif
+
 void main()
 {
+#ifdef LIGHT_DISTANCE
+   position_in_wc = vec3(WorldMatrix * vec4(v_position, 1.0f));
+#endif
    gl_Position = ModelViewProjectionMatrix * vec4(v_position, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+#version 460
+
+// MAX_LIGHTS and the other constants in capitals are defined by the renderer for each variant.
+
+// the position and the spotlight direction are already in the eye coordinates.
+struct LightInfo
+{
+   vec4 Position;
+   vec4 AmbientColor;
+   vec4 DiffuseColor;
+   vec4 SpecularColor;
+   vec3 SpotlightDirection;
+   float SpotlightCutoffCosine;
+   float SpotlightCutoffAngle;
+   float SpotlightFeather;
+   float FallOffRadius;
+   int LightSwitch;
+};
+layout (std140, binding = 0) uniform LightBlock
+{
+   vec4 GlobalAmbient;
+   int UseLight;
+   int LightNum;
+   LightInfo Lights[MAX_LIGHTS];
+};
+
+struct MateralInfo {
+   vec4 EmissionColor;
+   vec4 AmbientColor;
+   vec4 DiffuseColor;
+   vec4 SpecularColor;
+   float SpecularExponent;
+};
+#ifndef DEFERRED_SHADING
+uniform MateralInfo Material;
+#endif
+
+// the moments keep the distance to the point light on the six faces of the cube.
+layout (binding = 0) uniform samplerCube MomentsMap;
+
+uniform mat4 ProjectionMatrix;
+uniform vec3 LightPosition;
+uniform float LightFarPlane;
+uniform float MinVariance;
+uniform int LightIndex;
+
+#ifdef DEFERRED_SHADING
+#include "../deferred/gbuffer_decoder.glsl"
+#else
+in vec4 position_in_wc;
+in vec3 position_in_ec;
+in vec3 normal_in_ec;
+in vec2 tex_coord;
+#endif
+
+layout (location = 0) out vec4 final_color;
+
+const float zero = 0.0f;
+const float one = 1.0f;
+const float half_pi = 1.57079632679489661923132169163975144f;
+
+bool IsPointLight(in vec4 light_position)
+{
+   return light_position.w != zero;
+}
+
+float getAttenuation(in vec3 light_vector, in int light_index)
+{
+   float squared_distance = dot( light_vector, light_vector );
+   float distance = sqrt( squared_distance );
+   float radius = Lights[light_index].FallOffRadius;
+   if (distance <= radius) return one;
+
+   return clamp( radius * radius / squared_distance, zero, one );
+}
+
+float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
+{
+   // the cutoff cosine is -1 when the light is not a spotlight.
+   if (Lights[light_index].SpotlightCutoffCosine <= -one) return one;
+
+   float factor = dot( -normalized_light_vector, Lights[light_index].SpotlightDirection );
+   if (factor >= Lights[light_index].SpotlightCutoffCosine) {
+      float normalized_angle = acos( factor ) * half_pi / Lights[light_index].SpotlightCutoffAngle;
+      float threshold = half_pi * (one - Lights[light_index].SpotlightFeather);
+      return normalized_angle <= threshold ? one :
+         cos( half_pi * (normalized_angle - threshold) / (half_pi - threshold) );
+   }
+   return zero;
+}
+
+float getChebyshevUpperBound(in vec3 light_to_position, in float t, in vec3 dx, in vec3 dy)
+{
+   // the cube map is prefiltered and has the full mip chain, so the trilinear fetch is enough.
+   vec2 moments = textureGrad( MomentsMap, light_to_position, dx, dy ).rg;
+   if (t <= moments.x) return one;
+
+   float variance = max( moments.y - moments.x * moments.x, MinVariance );
+   float d = t - moments.x;
+   return variance / (variance + d * d);
+}
+
+float reduceLightBleeding(in float shadow)
+{
+   const float light_bleeding_reduction_amount = LIGHT_BLEEDING_REDUCTION;
+   return clamp( (shadow - light_bleeding_reduction_amount) / (one - light_bleeding_reduction_amount), zero, one );
+}
+
+float getShadowWithOVSM()
+{
+   // the distance is normalized by the far plane of the faces just like the moments, so no face is selected here.
+   vec3 light_to_position = position_in_wc.xyz - LightPosition;
+
+   // the derivatives are computed before branching because they are undefined in non-uniform control flow.
+   vec3 dx = dFdx( light_to_position );
+   vec3 dy = dFdy( light_to_position );
+
+   float t = length( light_to_position ) / LightFarPlane;
+   if (t < one) {
+      float shadow = getChebyshevUpperBound( light_to_position, t, dx, dy );
+      //return reduceLightBleeding( shadow );
+      return shadow;
+   }
+   return one;
+}
+
+vec4 calculateLightingEquation()
+{
+   vec4 color = Material.EmissionColor + GlobalAmbient * Material.AmbientColor;
+
+   if (Lights[LightIndex].LightSwitch == 0) return color;
+      
+   vec4 light_position_in_ec = Lights[LightIndex].Position;
+      
+   float final_effect_factor = one;
+   vec3 light_vector = light_position_in_ec.xyz - position_in_ec;
+   if (IsPointLight( light_position_in_ec )) {
+      float attenuation = getAttenuation( light_vector, LightIndex );
+
+      light_vector = normalize( light_vector );
+      float spotlight_factor = getSpotlightFactor( light_vector, LightIndex );
+      final_effect_factor = attenuation * spotlight_factor;
+   }
+   else light_vector = normalize( light_position_in_ec.xyz );
+   
+   if (final_effect_factor <= zero) return color;
+
+   vec4 local_color = Lights[LightIndex].AmbientColor * Material.AmbientColor;
+
+   float diffuse_intensity = max( dot( normal_in_ec, light_vector ), zero );
+   local_color += diffuse_intensity * Lights[LightIndex].DiffuseColor * Material.DiffuseColor;
+
+   vec3 halfway_vector = normalize( light_vector - normalize( position_in_ec ) );
+   float specular_intensity = max( dot( normal_in_ec, halfway_vector ), zero );
+   local_color += 
+      pow( specular_intensity, Material.SpecularExponent ) * 
+      Lights[LightIndex].SpecularColor * Material.SpecularColor;
+
+   color += local_color * final_effect_factor * getShadowWithOVSM();
+   return color;
+}
+
+void main()
+{
+#ifdef DEFERRED_SHADING
+   // the background is shaded as well and discarded at the end, so the derivatives stay defined around the edges.
+   bool is_covered = readGeometryBuffer();
+#endif
+   final_color = bool(UseLight) ? calculateLightingEquation() : Material.DiffuseColor;
+#ifdef DEFERRED_SHADING
+   if (!is_covered) discard;
+#endif
+}
\ No newline at end of file
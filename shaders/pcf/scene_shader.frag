@@ -1,20 +1,28 @@
 #version 460
 
-#define MAX_LIGHTS 32
+// MAX_LIGHTS and the other constants in capitals are defined by the renderer for each variant.
 
+// the position and the spotlight direction are already in the eye coordinates.
 struct LightInfo
 {
-   int LightSwitch;
    vec4 Position;
    vec4 AmbientColor;
    vec4 DiffuseColor;
    vec4 SpecularColor;
    vec3 SpotlightDirection;
+   float SpotlightCutoffCosine;
    float SpotlightCutoffAngle;
    float SpotlightFeather;
    float FallOffRadius;
+   int LightSwitch;
+};
+layout (std140, binding = 0) uniform LightBlock
+{
+   vec4 GlobalAmbient;
+   int UseLight;
+   int LightNum;
+   LightInfo Lights[MAX_LIGHTS];
 };
-uniform LightInfo Lights[MAX_LIGHTS];
 
 struct MateralInfo {
    vec4 EmissionColor;
@@ -23,22 +31,24 @@ struct MateralInfo {
    vec4 SpecularColor;
    float SpecularExponent;
 };
+#ifndef DEFERRED_SHADING
 uniform MateralInfo Material;
+#endif
 
 layout (binding = 0) uniform sampler2DShadow DepthMap;
 
-uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
 uniform mat4 LightViewProjectionMatrix;
-uniform int UseLight;
 uniform int LightIndex;
-uniform int LightNum;
-uniform vec4 GlobalAmbient;
 
+#ifdef DEFERRED_SHADING
+#include "../deferred/gbuffer_decoder.glsl"
+#else
 in vec4 position_in_wc;
 in vec3 position_in_ec;
 in vec3 normal_in_ec;
 in vec2 tex_coord;
+#endif
 
 layout (location = 0) out vec4 final_color;
 
@@ -63,14 +73,12 @@ float getAttenuation(in vec3 light_vector, in int light_index)
 
 float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
 {
-   if (Lights[light_index].SpotlightCutoffAngle >= 180.0f) return one;
-
-   vec4 direction_in_ec = transpose( inverse( ViewMatrix ) ) * vec4(Lights[light_index].SpotlightDirection, zero);
-   vec3 normalized_direction = normalize( direction_in_ec.xyz );
-   float factor = dot( -normalized_light_vector, normalized_direction );
-   float cutoff_angle = radians( clamp( Lights[light_index].SpotlightCutoffAngle, zero, 90.0f ) );
-   if (factor >= cos( cutoff_angle )) {
-      float normalized_angle = acos( factor ) * half_pi / cutoff_angle;
+   // the cutoff cosine is -1 when the light is not a spotlight.
+   if (Lights[light_index].SpotlightCutoffCosine <= -one) return one;
+
+   float factor = dot( -normalized_light_vector, Lights[light_index].SpotlightDirection );
+   if (factor >= Lights[light_index].SpotlightCutoffCosine) {
+      float normalized_angle = acos( factor ) * half_pi / Lights[light_index].SpotlightCutoffAngle;
       float threshold = half_pi * (one - Lights[light_index].SpotlightFeather);
       return normalized_angle <= threshold ? one :
          cos( half_pi * (normalized_angle - threshold) / (half_pi - threshold) );
@@ -80,7 +88,7 @@ float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
 
 float getShadowWithPCF()
 {
-   const float bias_for_shadow_acne = 0.005f;
+   const float bias_for_shadow_acne = PCF_DEPTH_BIAS;
    vec4 position_in_light_cc = LightViewProjectionMatrix * position_in_wc;
    vec4 depth_map_coord = vec4(
       0.5f * position_in_light_cc.xyz / position_in_light_cc.w + 0.5f,
@@ -91,9 +99,9 @@ float getShadowWithPCF()
    vec2 dx = dFdx( depth_map_coord.xy );
    vec2 dy = dFdy( depth_map_coord.xy );
 
-   const float epsilon = 1e-2f;
+   const float epsilon = SHADOW_MAP_BORDER;
    const vec2 min_size = vec2(one);
-   const vec2 max_size = vec2(32.0f);
+   const vec2 max_size = vec2(PCF_MAX_FILTER_SIZE);
    if (epsilon <= depth_map_coord.x && depth_map_coord.x <= one - epsilon &&
        epsilon <= depth_map_coord.y && depth_map_coord.y <= one - epsilon &&
        zero < depth_map_coord.w) {
@@ -110,8 +118,11 @@ float getShadowWithPCF()
       filter_size *= normalizer;
       vec2 lower_left = depth_map_coord.xy - 0.5f * filter_size;
       float shadow = zero;
-      for (int y = 0; y < window_size.y; ++y) {
-         for (int x = 0; x < window_size.x; ++x) {
+      // the loops are bounded by the constant, so the compiler can unroll them for the variant in use.
+      for (int y = 0; y < PCF_MAX_FILTER_SIZE; ++y) {
+         if (y >= window_size.y) break;
+         for (int x = 0; x < PCF_MAX_FILTER_SIZE; ++x) {
+            if (x >= window_size.x) break;
             vec3 tex_coord = vec3(lower_left + vec2(x, y) * normalizer, depth_map_coord.z);
             shadow += texture( DepthMap, tex_coord );
          }
@@ -127,7 +138,7 @@ vec4 calculateLightingEquation()
 
    if (Lights[LightIndex].LightSwitch == 0) return color;
       
-   vec4 light_position_in_ec = ViewMatrix * Lights[LightIndex].Position;
+   vec4 light_position_in_ec = Lights[LightIndex].Position;
       
    float final_effect_factor = one;
    vec3 light_vector = light_position_in_ec.xyz - position_in_ec;
@@ -159,5 +170,12 @@ vec4 calculateLightingEquation()
 
 void main()
 {
+#ifdef DEFERRED_SHADING
+   // the background is shaded as well and discarded at the end, so the derivatives stay defined around the edges.
+   bool is_covered = readGeometryBuffer();
+#endif
    final_color = bool(UseLight) ? calculateLightingEquation() : Material.DiffuseColor;
+#ifdef DEFERRED_SHADING
+   if (!is_covered) discard;
+#endif
 }
\ No newline at end of file
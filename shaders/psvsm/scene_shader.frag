@@ -1,20 +1,28 @@
 #version 460
 
-#define MAX_LIGHTS 32
+// MAX_LIGHTS and the other constants in capitals are defined by the renderer for each variant.
 
+// the position and the spotlight direction are already in the eye coordinates.
 struct LightInfo
 {
-   int LightSwitch;
    vec4 Position;
    vec4 AmbientColor;
    vec4 DiffuseColor;
    vec4 SpecularColor;
    vec3 SpotlightDirection;
+   float SpotlightCutoffCosine;
    float SpotlightCutoffAngle;
    float SpotlightFeather;
    float FallOffRadius;
+   int LightSwitch;
+};
+layout (std140, binding = 0) uniform LightBlock
+{
+   vec4 GlobalAmbient;
+   int UseLight;
+   int LightNum;
+   LightInfo Lights[MAX_LIGHTS];
 };
-uniform LightInfo Lights[MAX_LIGHTS];
 
 struct MateralInfo {
    vec4 EmissionColor;
@@ -23,22 +31,33 @@ struct MateralInfo {
    vec4 SpecularColor;
    float SpecularExponent;
 };
+#ifndef DEFERRED_SHADING
 uniform MateralInfo Material;
+#endif
 
+#ifdef ATLAS
+// each split has its own tile of the atlas as the offset and the size in the texture coordinates.
+layout (binding = 0) uniform sampler2D MomentsMap;
+uniform vec4 AtlasTiles[SPLIT_NUM];
+#else
 layout (binding = 0) uniform sampler2DArray MomentsMap;
+#endif
 
-uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
-uniform mat4 LightViewProjectionMatrix[3];
-uniform float SplitPositions[3];
-uniform int UseLight;
+uniform mat4 LightViewProjectionMatrix[SPLIT_NUM];
+uniform float SplitPositions[SPLIT_NUM];
+uniform float MinVariance;
 uniform int LightIndex;
-uniform int LightNum;
-uniform vec4 GlobalAmbient;
+uniform int UseSAT;
+uniform float MaxFilterSize;
 
-in vec3 position_in_wc;
+#ifdef DEFERRED_SHADING
+#include "../deferred/gbuffer_decoder.glsl"
+#else
+in vec4 position_in_wc;
 in vec3 position_in_ec;
 in vec3 normal_in_ec;
+#endif
 
 layout (location = 0) out vec4 final_color;
 
@@ -63,14 +82,12 @@ float getAttenuation(in vec3 light_vector, in int light_index)
 
 float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
 {
-   if (Lights[light_index].SpotlightCutoffAngle >= 180.0f) return one;
-
-   vec4 direction_in_ec = transpose( inverse( ViewMatrix ) ) * vec4(Lights[light_index].SpotlightDirection, zero);
-   vec3 normalized_direction = normalize( direction_in_ec.xyz );
-   float factor = dot( -normalized_light_vector, normalized_direction );
-   float cutoff_angle = radians( clamp( Lights[light_index].SpotlightCutoffAngle, zero, 90.0f ) );
-   if (factor >= cos( cutoff_angle )) {
-      float normalized_angle = acos( factor ) * half_pi / cutoff_angle;
+   // the cutoff cosine is -1 when the light is not a spotlight.
+   if (Lights[light_index].SpotlightCutoffCosine <= -one) return one;
+
+   float factor = dot( -normalized_light_vector, Lights[light_index].SpotlightDirection );
+   if (factor >= Lights[light_index].SpotlightCutoffCosine) {
+      float normalized_angle = acos( factor ) * half_pi / Lights[light_index].SpotlightCutoffAngle;
       float threshold = half_pi * (one - Lights[light_index].SpotlightFeather);
       return normalized_angle <= threshold ? one :
          cos( half_pi * (normalized_angle - threshold) / (half_pi - threshold) );
@@ -81,44 +98,114 @@ float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
 float getChebyshevUpperBound(in vec3 moments_map_coord, in int split)
 {
    float t = moments_map_coord.z;
+#ifdef ATLAS
+   // the bilinear taps stay inside the tile, so the neighboring splits never bleed into each other.
+   vec2 half_texel = 0.5f / vec2(textureSize( MomentsMap, 0 ));
+   vec4 tile = AtlasTiles[split];
+   vec2 atlas_coord = clamp(
+      tile.xy + moments_map_coord.xy * tile.zw, tile.xy + half_texel, tile.xy + tile.zw - half_texel
+   );
+   vec2 moments = texture( MomentsMap, atlas_coord ).rg;
+#else
    vec2 moments = texture( MomentsMap, vec3(moments_map_coord.xy, float(split)) ).rg;
+#endif
    if (t <= moments.x) return one;
 
-   const float min_variance = 1e-6f;
+   float variance = max( moments.y - moments.x * moments.x, MinVariance );
+   float d = t - moments.x;
+   return variance / (variance + d * d);
+}
+
+#ifndef ATLAS
+vec2 getMomentsFromSAT(in ivec4 coord, in ivec2 offset, in int split)
+{
+   vec2 s00 = texelFetchOffset( MomentsMap, ivec3(coord.xy, split), 0, offset ).rg;
+   vec2 s10 = texelFetchOffset( MomentsMap, ivec3(coord.zy, split), 0, offset ).rg;
+   vec2 s01 = texelFetchOffset( MomentsMap, ivec3(coord.xw, split), 0, offset ).rg;
+   vec2 s11 = texelFetchOffset( MomentsMap, ivec3(coord.zw, split), 0, offset ).rg;
+   return s11 - s01 - s10 + s00;
+}
+
+float getChebyshevUpperBoundFromSAT(in vec3 moments_map_coord, in vec2 dx, in vec2 dy, in int split)
+{
+   vec2 shadow_size = vec2(textureSize( MomentsMap, 0 ).xy);
+   vec2 max_size = min( vec2(MaxFilterSize), shadow_size - 2.0f );
+   vec2 filter_size = round( clamp( 2.0f * (abs( dx ) + abs( dy )) * shadow_size, vec2(one), max_size ) );
+
+   // the tile is kept inside the layer, so the fetches with the offsets never leave the table.
+   vec2 lower_left = clamp(
+      moments_map_coord.xy * shadow_size - 0.5f * filter_size, vec2(zero), shadow_size - filter_size - 2.0f
+   );
+   vec2 upper_right = lower_left + filter_size;
+   ivec4 tile = ivec4(lower_left, upper_right);
+
+   vec4 weights;
+   weights.xy = fract( lower_left );
+   weights.zw = one - weights.xy;
+   weights = weights.xzxz * weights.wyyw;
+
+   float normalizer = one / (filter_size.x * filter_size.y);
+   vec2 m00 = getMomentsFromSAT( tile, ivec2(0), split ) * normalizer;
+   vec2 m10 = getMomentsFromSAT( tile, ivec2(1, 0), split ) * normalizer;
+   vec2 m01 = getMomentsFromSAT( tile, ivec2(0, 1), split ) * normalizer;
+   vec2 m11 = getMomentsFromSAT( tile, ivec2(1), split ) * normalizer;
+   vec2 moments = vec2(
+      dot( weights, vec4(m10.x, m01.x, m11.x, m00.x) ),
+      dot( weights, vec4(m10.y, m01.y, m11.y, m00.y) )
+   );
+   float t = moments_map_coord.z;
+   if (t <= moments.x) return one;
+
+   const float min_variance = SAT_MIN_VARIANCE;
    float variance = max( moments.y - moments.x * moments.x, min_variance );
    float d = t - moments.x;
    return variance / (variance + d * d);
 }
+#endif
 
 float reduceLightBleeding(in float shadow)
 {
-   const float light_bleeding_reduction_amount = 0.18f;
+   const float light_bleeding_reduction_amount = LIGHT_BLEEDING_REDUCTION;
    return clamp( (shadow - light_bleeding_reduction_amount) / (one - light_bleeding_reduction_amount), zero, one );
 }
 
 float getShadowWithPSVSM()
 {
+   // the footprint is taken in the world before a split is chosen, so it stays defined across the seams
+   // and each cascade filters about the same area in the world.
+   vec3 position_dx = dFdx( position_in_wc.xyz );
+   vec3 position_dy = dFdy( position_in_wc.xyz );
+
    float depth = -position_in_ec.z;
-   vec3 split_positions = vec3(SplitPositions[0], SplitPositions[1], SplitPositions[2]);
-   int split = int(dot( vec3(one), vec3(greaterThan( vec3(depth), split_positions )) )) - 1;
+   // the first split also takes the fragments nearer than its start, which it may not cover with the visible depths.
+   int split = 0;
+   for (int i = 1; i < SPLIT_NUM; ++i) {
+      if (depth > SplitPositions[i]) split++;
+   }
 
    // https://forum.beyond3d.com/threads/variance-shadow-maps-demo-d3d10.37062/
-   const int split_lookup[8] = { 0, 1, 1, 2, 2, 2, 2, 3 };
+   // the lookup table of the demo is the most significant bit, which also covers more than three splits.
    int power_of_two = 1 << split;
    int split_x = int(abs( dFdx( power_of_two ) ));
    int split_y = int(abs( dFdy( power_of_two ) ));
    int split_xy = int(abs( dFdx( split_y ) ));
    int split_max = max( split_xy, max( split_x, split_y ) );
-   // split_max = min( split_max, 8 );
-   split = split_max > 0 ? split_lookup[split_max - 1] : split;
+   split = split_max > 0 ? min( findMSB( split_max ), SPLIT_NUM - 1 ) : split;
 
-   vec4 position_in_light = LightViewProjectionMatrix[split] * vec4(position_in_wc, 1.0f);
+   vec4 position_in_light = LightViewProjectionMatrix[split] * position_in_wc;
    vec4 moments_map_coord = vec4(0.5f * position_in_light.xyz / position_in_light.w + 0.5f, position_in_light.w);
 
-   const float epsilon = 1e-2f;
+   const float epsilon = SHADOW_MAP_BORDER;
    if (epsilon <= moments_map_coord.x && moments_map_coord.x <= one - epsilon &&
        epsilon <= moments_map_coord.y && moments_map_coord.y <= one - epsilon &&
        zero < moments_map_coord.w) {
+#ifndef ATLAS
+      if (bool(UseSAT)) {
+         vec2 dx = 0.5f * (LightViewProjectionMatrix[split] * vec4(position_dx, zero)).xy;
+         vec2 dy = 0.5f * (LightViewProjectionMatrix[split] * vec4(position_dy, zero)).xy;
+         return reduceLightBleeding( getChebyshevUpperBoundFromSAT( moments_map_coord.xyz, dx, dy, split ) );
+      }
+#endif
       float shadow = getChebyshevUpperBound( moments_map_coord.xyz, split );
       //return reduceLightBleeding( shadow );
       return shadow;
@@ -132,7 +219,7 @@ vec4 calculateLightingEquation()
 
    if (Lights[LightIndex].LightSwitch == 0) return color;
       
-   vec4 light_position_in_ec = ViewMatrix * Lights[LightIndex].Position;
+   vec4 light_position_in_ec = Lights[LightIndex].Position;
       
    float final_effect_factor = one;
    vec3 light_vector = light_position_in_ec.xyz - position_in_ec;
@@ -164,5 +251,12 @@ vec4 calculateLightingEquation()
 
 void main()
 {
+#ifdef DEFERRED_SHADING
+   // the background is shaded as well and discarded at the end, so the derivatives stay defined around the edges.
+   bool is_covered = readGeometryBuffer();
+#endif
    final_color = bool(UseLight) ? calculateLightingEquation() : Material.DiffuseColor;
+#ifdef DEFERRED_SHADING
+   if (!is_covered) discard;
+#endif
 }
\ No newline at end of file
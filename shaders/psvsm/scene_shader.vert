@@ -9,7 +9,7 @@ layout (location = 0) in vec3 v_position;
 layout (location = 1) in vec3 v_normal;
 layout (location = 2) in vec2 v_tex_coord;
 
-out vec3 position_in_wc;
+out vec4 position_in_wc;
 out vec3 position_in_ec;
 out vec3 normal_in_ec;
 
@@ -23,7 +23,7 @@ void main()
    position_in_ec = e_position.xyz;
    normal_in_ec = normalize( e_normal.xyz );
 
-   position_in_wc = vec3(WorldMatrix * vec4(v_position, 1.0f));
+   position_in_wc = WorldMatrix * vec4(v_position, 1.0f);
 
    gl_Position = ModelViewProjectionMatrix * vec4(v_position, 1.0f);
 }
\ No newline at end of file
@@ -1,20 +1,28 @@
 #version 460
 
-#define MAX_LIGHTS 32
+// MAX_LIGHTS and the other constants in capitals are defined by the renderer for each variant.
 
+// the position and the spotlight direction are already in the eye coordinates.
 struct LightInfo
 {
-   int LightSwitch;
    vec4 Position;
    vec4 AmbientColor;
    vec4 DiffuseColor;
    vec4 SpecularColor;
    vec3 SpotlightDirection;
+   float SpotlightCutoffCosine;
    float SpotlightCutoffAngle;
    float SpotlightFeather;
    float FallOffRadius;
+   int LightSwitch;
+};
+layout (std140, binding = 0) uniform LightBlock
+{
+   vec4 GlobalAmbient;
+   int UseLight;
+   int LightNum;
+   LightInfo Lights[MAX_LIGHTS];
 };
-uniform LightInfo Lights[MAX_LIGHTS];
 
 struct MateralInfo {
    vec4 EmissionColor;
@@ -23,22 +31,30 @@ struct MateralInfo {
    vec4 SpecularColor;
    float SpecularExponent;
 };
+#ifndef DEFERRED_SHADING
 uniform MateralInfo Material;
+#endif
 
 layout (binding = 0) uniform sampler2D MomentsMap;
+layout (binding = 4) uniform usampler2D IntegerSATMap;
 
-uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
 uniform mat4 LightViewProjectionMatrix;
-uniform int UseLight;
 uniform int LightIndex;
-uniform int LightNum;
-uniform vec4 GlobalAmbient;
+uniform float MaxFilterSize;
+uniform int UseIntegerSAT;
+uniform int UseTextureGather;
+uniform int MeanLevel;
+uniform float FixedPointScale;
 
+#ifdef DEFERRED_SHADING
+#include "../deferred/gbuffer_decoder.glsl"
+#else
 in vec4 position_in_wc;
 in vec3 position_in_ec;
 in vec3 normal_in_ec;
 in vec2 tex_coord;
+#endif
 
 layout (location = 0) out vec4 final_color;
 
@@ -63,14 +79,12 @@ float getAttenuation(in vec3 light_vector, in int light_index)
 
 float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
 {
-   if (Lights[light_index].SpotlightCutoffAngle >= 180.0f) return one;
-
-   vec4 direction_in_ec = transpose( inverse( ViewMatrix ) ) * vec4(Lights[light_index].SpotlightDirection, zero);
-   vec3 normalized_direction = normalize( direction_in_ec.xyz );
-   float factor = dot( -normalized_light_vector, normalized_direction );
-   float cutoff_angle = radians( clamp( Lights[light_index].SpotlightCutoffAngle, zero, 90.0f ) );
-   if (factor >= cos( cutoff_angle )) {
-      float normalized_angle = acos( factor ) * half_pi / cutoff_angle;
+   // the cutoff cosine is -1 when the light is not a spotlight.
+   if (Lights[light_index].SpotlightCutoffCosine <= -one) return one;
+
+   float factor = dot( -normalized_light_vector, Lights[light_index].SpotlightDirection );
+   if (factor >= Lights[light_index].SpotlightCutoffCosine) {
+      float normalized_angle = acos( factor ) * half_pi / Lights[light_index].SpotlightCutoffAngle;
       float threshold = half_pi * (one - Lights[light_index].SpotlightFeather);
       return normalized_angle <= threshold ? one :
          cos( half_pi * (normalized_angle - threshold) / (half_pi - threshold) );
@@ -80,6 +94,16 @@ float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
 
 vec2 getMomentsFromSAT(in ivec4 coord, in ivec2 offset)
 {
+   if (bool(UseIntegerSAT)) {
+      // the corners may have wrapped around, but the area sum of the deviations fits in 32 bits,
+      // so the uint arithmetic gives the exact sum, which is then reinterpreted as signed.
+      uvec2 u00 = texelFetchOffset( IntegerSATMap, coord.xy, 0, offset ).rg;
+      uvec2 u10 = texelFetchOffset( IntegerSATMap, coord.zy, 0, offset ).rg;
+      uvec2 u01 = texelFetchOffset( IntegerSATMap, coord.xw, 0, offset ).rg;
+      uvec2 u11 = texelFetchOffset( IntegerSATMap, coord.zw, 0, offset ).rg;
+      return vec2(ivec2(u11 - u01 - u10 + u00)) / FixedPointScale;
+   }
+
    vec2 s00 = texelFetchOffset( MomentsMap, coord.xy, 0, offset ).rg;
    vec2 s10 = texelFetchOffset( MomentsMap, coord.zy, 0, offset ).rg;
    vec2 s01 = texelFetchOffset( MomentsMap, coord.xw, 0, offset ).rg;
@@ -87,21 +111,57 @@ vec2 getMomentsFromSAT(in ivec4 coord, in ivec2 offset)
    return s11 - s01 - s10 + s00;
 }
 
-float getChebyshevUpperBound(in ivec4 tile, in vec4 weights, in float t)
+vec2 getMomentsWithFetch(in ivec4 tile, in vec4 weights, in float normalizer)
 {
-   vec2 filter_size = vec2(tile.zw - tile.xy);
-   float normalizer = one / (filter_size.x * filter_size.y);
    vec2 m00 = getMomentsFromSAT( tile, ivec2(0) ) * normalizer;
    vec2 m10 = getMomentsFromSAT( tile, ivec2(1, 0) ) * normalizer;
    vec2 m01 = getMomentsFromSAT( tile, ivec2(0, 1) ) * normalizer;
    vec2 m11 = getMomentsFromSAT( tile, ivec2(1) ) * normalizer;
-   vec2 moments = vec2(
+   return vec2(
       dot( weights, vec4(m10.x, m01.x, m11.x, m00.x) ),
       dot( weights, vec4(m10.y, m01.y, m11.y, m00.y) )
    );
+}
+
+// the four bilinear taps share their corners, so the sixteen corners are gathered as four 2x2 quads per channel.
+// the components of a quad are in the order of the offsets (0, 1), (1, 1), (1, 0) and (0, 0),
+// so the differences of the quads are the sums of the four taps at once.
+vec2 getMomentsWithGather(in ivec4 tile, in vec4 weights, in float normalizer)
+{
+   vec2 inverse_size = one / vec2(textureSize( MomentsMap, 0 ));
+   vec2 c00 = (vec2(tile.xy) + one) * inverse_size;
+   vec2 c10 = (vec2(tile.zy) + one) * inverse_size;
+   vec2 c01 = (vec2(tile.xw) + one) * inverse_size;
+   vec2 c11 = (vec2(tile.zw) + one) * inverse_size;
+
+   vec4 r, g;
+   if (bool(UseIntegerSAT)) {
+      uvec4 ur = textureGather( IntegerSATMap, c11, 0 ) - textureGather( IntegerSATMap, c01, 0 ) -
+         textureGather( IntegerSATMap, c10, 0 ) + textureGather( IntegerSATMap, c00, 0 );
+      uvec4 ug = textureGather( IntegerSATMap, c11, 1 ) - textureGather( IntegerSATMap, c01, 1 ) -
+         textureGather( IntegerSATMap, c10, 1 ) + textureGather( IntegerSATMap, c00, 1 );
+      r = vec4(ivec4(ur)) / FixedPointScale;
+      g = vec4(ivec4(ug)) / FixedPointScale;
+   }
+   else {
+      r = textureGather( MomentsMap, c11, 0 ) - textureGather( MomentsMap, c01, 0 ) -
+         textureGather( MomentsMap, c10, 0 ) + textureGather( MomentsMap, c00, 0 );
+      g = textureGather( MomentsMap, c11, 1 ) - textureGather( MomentsMap, c01, 1 ) -
+         textureGather( MomentsMap, c10, 1 ) + textureGather( MomentsMap, c00, 1 );
+   }
+   return vec2(dot( weights, (r * normalizer).zxyw ), dot( weights, (g * normalizer).zxyw ));
+}
+
+float getChebyshevUpperBound(in ivec4 tile, in vec4 weights, in float t)
+{
+   vec2 filter_size = vec2(tile.zw - tile.xy);
+   float normalizer = one / (filter_size.x * filter_size.y);
+   vec2 moments = bool(UseTextureGather) ?
+      getMomentsWithGather( tile, weights, normalizer ) : getMomentsWithFetch( tile, weights, normalizer );
+   if (bool(UseIntegerSAT)) moments += texelFetch( MomentsMap, ivec2(0), MeanLevel ).rg;
    if (t <= moments.x) return one;
 
-   const float min_variance = 3e-4f;
+   const float min_variance = SAT_MIN_VARIANCE;
    float variance = max( moments.y - moments.x * moments.x, min_variance );
    float d = t - moments.x;
    return variance / (variance + d * d);
@@ -109,7 +169,7 @@ float getChebyshevUpperBound(in ivec4 tile, in vec4 weights, in float t)
 
 float reduceLightBleeding(in float shadow)
 {
-   const float light_bleeding_reduction_amount = 0.18f;
+   const float light_bleeding_reduction_amount = LIGHT_BLEEDING_REDUCTION;
    return clamp( (shadow - light_bleeding_reduction_amount) / (one - light_bleeding_reduction_amount), zero, one );
 }
 
@@ -124,7 +184,7 @@ float getShadowWithSATVSM()
    vec2 dx = dFdx( moments_map_coord.xy );
    vec2 dy = dFdy( moments_map_coord.xy );
 
-   const float epsilon = 1e-1f;
+   const float epsilon = SAT_SHADOW_MAP_BORDER;
    const vec2 min_size = vec2(one);
    if (epsilon <= moments_map_coord.x && moments_map_coord.x <= one - epsilon &&
        epsilon <= moments_map_coord.y && moments_map_coord.y <= one - epsilon &&
@@ -134,7 +194,7 @@ float getShadowWithSATVSM()
       // this filter is designed to reduce artifacts causing when the filter size from pcf is used.
       // the filter size gets increased when the camera is closer to hide artifacts.
       vec2 filter_size = smoothstep( 1.05f - abs( dx ) - abs( dy ), vec2(zero), vec2(one) );
-      filter_size = round( clamp( filter_size * shadow_size, min_size, shadow_size ) );
+      filter_size = round( clamp( filter_size * shadow_size, min_size, min( shadow_size, vec2(MaxFilterSize) ) ) );
       //vec2 filter_size = round( clamp( 2.0f * (abs( dx ) + abs( dy )) * shadow_size, min_size, max_size ) );
 
       vec2 lower_left = moments_map_coord.xy * shadow_size - 0.5f * filter_size;
@@ -157,7 +217,7 @@ vec4 calculateLightingEquation()
 
    if (Lights[LightIndex].LightSwitch == 0) return color;
       
-   vec4 light_position_in_ec = ViewMatrix * Lights[LightIndex].Position;
+   vec4 light_position_in_ec = Lights[LightIndex].Position;
       
    float final_effect_factor = one;
    vec3 light_vector = light_position_in_ec.xyz - position_in_ec;
@@ -189,5 +249,12 @@ vec4 calculateLightingEquation()
 
 void main()
 {
+#ifdef DEFERRED_SHADING
+   // the background is shaded as well and discarded at the end, so the derivatives stay defined around the edges.
+   bool is_covered = readGeometryBuffer();
+#endif
    final_color = bool(UseLight) ? calculateLightingEquation() : Material.DiffuseColor;
+#ifdef DEFERRED_SHADING
+   if (!is_covered) discard;
+#endif
 }
\ No newline at end of file
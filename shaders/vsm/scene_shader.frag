@@ -1,20 +1,28 @@
 #version 460
 
-#define MAX_LIGHTS 32
+// MAX_LIGHTS and the other constants in capitals are defined by the renderer for each variant.
 
+// the position and the spotlight direction are already in the eye coordinates.
 struct LightInfo
 {
-   int LightSwitch;
    vec4 Position;
    vec4 AmbientColor;
    vec4 DiffuseColor;
    vec4 SpecularColor;
    vec3 SpotlightDirection;
+   float SpotlightCutoffCosine;
    float SpotlightCutoffAngle;
    float SpotlightFeather;
    float FallOffRadius;
+   int LightSwitch;
+};
+layout (std140, binding = 0) uniform LightBlock
+{
+   vec4 GlobalAmbient;
+   int UseLight;
+   int LightNum;
+   LightInfo Lights[MAX_LIGHTS];
 };
-uniform LightInfo Lights[MAX_LIGHTS];
 
 struct MateralInfo {
    vec4 EmissionColor;
@@ -23,22 +31,54 @@ struct MateralInfo {
    vec4 SpecularColor;
    float SpecularExponent;
 };
+#ifndef DEFERRED_SHADING
 uniform MateralInfo Material;
+#endif
 
 layout (binding = 0) uniform sampler2D MomentsMap;
 
-uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
 uniform mat4 LightViewProjectionMatrix;
-uniform int UseLight;
+uniform float MinVariance;
 uniform int LightIndex;
-uniform int LightNum;
-uniform vec4 GlobalAmbient;
 
+#ifdef MULTIPLE_LIGHTS
+// every light has its own tile of the shadow atlas as the offset and the size in the texture coordinates,
+// and the lights without any tile are not shadowed. the tiles of the lights with a far plane hold the distances.
+uniform mat4 ShadowedLightMatrices[MAX_LIGHTS];
+uniform vec4 ShadowTiles[MAX_LIGHTS];
+uniform float ShadowedLightFarPlanes[MAX_LIGHTS];
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+// the froxels of the view frustum list the indices of the lights that reach them, which light_culling.comp fills.
+// the depth slices are spaced exponentially between the near and far distances of the cluster depth range.
+layout (std430, binding = 1) readonly buffer LightStorage
+{
+   LightInfo ClusteredLights[];
+};
+layout (std430, binding = 2) readonly buffer ClusterLightCounts
+{
+   uint LightCounts[];
+};
+layout (std430, binding = 3) readonly buffer ClusterLightIndices
+{
+   uint LightIndices[];
+};
+
+uniform ivec3 ClusterGridSize;
+uniform vec2 ClusterDepthRange;
+uniform vec2 ClusterTileSize;
+#endif
+
+#ifdef DEFERRED_SHADING
+#include "../deferred/gbuffer_decoder.glsl"
+#else
 in vec4 position_in_wc;
 in vec3 position_in_ec;
 in vec3 normal_in_ec;
 in vec2 tex_coord;
+#endif
 
 layout (location = 0) out vec4 final_color;
 
@@ -51,48 +91,45 @@ bool IsPointLight(in vec4 light_position)
    return light_position.w != zero;
 }
 
-float getAttenuation(in vec3 light_vector, in int light_index)
+float getAttenuation(in vec3 light_vector, in float radius)
 {
    float squared_distance = dot( light_vector, light_vector );
    float distance = sqrt( squared_distance );
-   float radius = Lights[light_index].FallOffRadius;
    if (distance <= radius) return one;
 
    return clamp( radius * radius / squared_distance, zero, one );
 }
 
-float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
+float getSpotlightFactor(in vec3 normalized_light_vector, in LightInfo light)
 {
-   if (Lights[light_index].SpotlightCutoffAngle >= 180.0f) return one;
+   // the cutoff cosine is -1 when the light is not a spotlight.
+   if (light.SpotlightCutoffCosine <= -one) return one;
 
-   vec4 direction_in_ec = transpose( inverse( ViewMatrix ) ) * vec4(Lights[light_index].SpotlightDirection, zero);
-   vec3 normalized_direction = normalize( direction_in_ec.xyz );
-   float factor = dot( -normalized_light_vector, normalized_direction );
-   float cutoff_angle = radians( clamp( Lights[light_index].SpotlightCutoffAngle, zero, 90.0f ) );
-   if (factor >= cos( cutoff_angle )) {
-      float normalized_angle = acos( factor ) * half_pi / cutoff_angle;
-      float threshold = half_pi * (one - Lights[light_index].SpotlightFeather);
+   float factor = dot( -normalized_light_vector, light.SpotlightDirection );
+   if (factor >= light.SpotlightCutoffCosine) {
+      float normalized_angle = acos( factor ) * half_pi / light.SpotlightCutoffAngle;
+      float threshold = half_pi * (one - light.SpotlightFeather);
       return normalized_angle <= threshold ? one :
          cos( half_pi * (normalized_angle - threshold) / (half_pi - threshold) );
    }
    return zero;
 }
 
-float getChebyshevUpperBound(in vec3 moments_map_coord)
+float getChebyshevUpperBound(in vec3 moments_map_coord, in vec2 dx, in vec2 dy)
 {
+   // the moments map is prefiltered and has the full mip chain, so the trilinear or anisotropic fetch is enough.
    float t = moments_map_coord.z;
-   vec2 moments = texture( MomentsMap, moments_map_coord.xy ).rg;
+   vec2 moments = textureGrad( MomentsMap, moments_map_coord.xy, dx, dy ).rg;
    if (t <= moments.x) return one;
 
-   const float min_variance = 1e-6f;
-   float variance = max( moments.y - moments.x * moments.x, min_variance );
+   float variance = max( moments.y - moments.x * moments.x, MinVariance );
    float d = t - moments.x;
    return variance / (variance + d * d);
 }
 
 float reduceLightBleeding(in float shadow)
 {
-   const float light_bleeding_reduction_amount = 0.18f;
+   const float light_bleeding_reduction_amount = LIGHT_BLEEDING_REDUCTION;
    return clamp( (shadow - light_bleeding_reduction_amount) / (one - light_bleeding_reduction_amount), zero, one );
 }
 
@@ -104,54 +141,131 @@ float getShadowWithVSM()
       position_in_light_cc.w
    );
 
-   const float epsilon = 1e-2f;
+   // the derivatives are computed before branching because they are undefined in non-uniform control flow.
+   vec2 dx = dFdx( moments_map_coord.xy );
+   vec2 dy = dFdy( moments_map_coord.xy );
+
+   const float epsilon = SHADOW_MAP_BORDER;
    if (epsilon <= moments_map_coord.x && moments_map_coord.x <= one - epsilon &&
        epsilon <= moments_map_coord.y && moments_map_coord.y <= one - epsilon &&
        zero < moments_map_coord.w) {
-      float shadow = getChebyshevUpperBound( moments_map_coord.xyz );
+      float shadow = getChebyshevUpperBound( moments_map_coord.xyz, dx, dy );
       //return reduceLightBleeding( shadow );
       return shadow;
    }
    return one;
 }
 
-vec4 calculateLightingEquation()
+#ifdef MULTIPLE_LIGHTS
+float getShadowFromAtlas(in int light_index)
 {
-   vec4 color = Material.EmissionColor + GlobalAmbient * Material.AmbientColor;
+   vec4 tile = ShadowTiles[light_index];
+   if (tile.z <= zero) return one;
+
+   vec4 position_in_light_cc = ShadowedLightMatrices[light_index] * position_in_wc;
+   vec4 moments_map_coord = vec4(
+      0.5f * position_in_light_cc.xyz / position_in_light_cc.w + 0.5f,
+      position_in_light_cc.w
+   );
+
+   const float epsilon = SHADOW_MAP_BORDER;
+   if (epsilon <= moments_map_coord.x && moments_map_coord.x <= one - epsilon &&
+       epsilon <= moments_map_coord.y && moments_map_coord.y <= one - epsilon &&
+       zero < moments_map_coord.w) {
+      // the atlas has no mip chain, and the bilinear taps stay inside the tile of the light.
+      vec2 half_texel = 0.5f / vec2(textureSize( MomentsMap, 0 ));
+      vec2 atlas_coord = clamp(
+         tile.xy + moments_map_coord.xy * tile.zw, tile.xy + half_texel, tile.xy + tile.zw - half_texel
+      );
+      float far_plane = ShadowedLightFarPlanes[light_index];
+      float t = far_plane > zero ?
+         length( position_in_ec - Lights[light_index].Position.xyz ) / far_plane : moments_map_coord.z;
+      vec2 moments = textureLod( MomentsMap, atlas_coord, zero ).rg;
+      if (t <= moments.x) return one;
+
+      float variance = max( moments.y - moments.x * moments.x, MinVariance );
+      float d = t - moments.x;
+      return variance / (variance + d * d);
+   }
+   return one;
+}
+#endif
+
+// it returns zero when the light does not reach the fragment, so the shadow is looked up only for the others.
+vec4 calculateLocalColor(in LightInfo light)
+{
+   if (light.LightSwitch == 0) return vec4(zero);
+
+   vec4 light_position_in_ec = light.Position;
 
-   if (Lights[LightIndex].LightSwitch == 0) return color;
-      
-   vec4 light_position_in_ec = ViewMatrix * Lights[LightIndex].Position;
-      
    float final_effect_factor = one;
    vec3 light_vector = light_position_in_ec.xyz - position_in_ec;
    if (IsPointLight( light_position_in_ec )) {
-      float attenuation = getAttenuation( light_vector, LightIndex );
+      float attenuation = getAttenuation( light_vector, light.FallOffRadius );
 
       light_vector = normalize( light_vector );
-      float spotlight_factor = getSpotlightFactor( light_vector, LightIndex );
+      float spotlight_factor = getSpotlightFactor( light_vector, light );
       final_effect_factor = attenuation * spotlight_factor;
    }
    else light_vector = normalize( light_position_in_ec.xyz );
-   
-   if (final_effect_factor <= zero) return color;
 
-   vec4 local_color = Lights[LightIndex].AmbientColor * Material.AmbientColor;
+   if (final_effect_factor <= zero) return vec4(zero);
+
+   vec4 local_color = light.AmbientColor * Material.AmbientColor;
 
    float diffuse_intensity = max( dot( normal_in_ec, light_vector ), zero );
-   local_color += diffuse_intensity * Lights[LightIndex].DiffuseColor * Material.DiffuseColor;
+   local_color += diffuse_intensity * light.DiffuseColor * Material.DiffuseColor;
 
    vec3 halfway_vector = normalize( light_vector - normalize( position_in_ec ) );
    float specular_intensity = max( dot( normal_in_ec, halfway_vector ), zero );
    local_color += 
       pow( specular_intensity, Material.SpecularExponent ) * 
-      Lights[LightIndex].SpecularColor * Material.SpecularColor;
+      light.SpecularColor * Material.SpecularColor;
+   return local_color * final_effect_factor;
+}
+
+#ifdef CLUSTERED_LIGHTS
+uint getClusterIndex()
+{
+   ivec2 tile = min( ivec2(gl_FragCoord.xy / ClusterTileSize), ClusterGridSize.xy - 1 );
+   float depth_ratio = max( -position_in_ec.z / ClusterDepthRange.x, one );
+   int slice = int(log( depth_ratio ) * float(ClusterGridSize.z) / log( ClusterDepthRange.y / ClusterDepthRange.x ));
+   slice = min( slice, ClusterGridSize.z - 1 );
+   return uint((slice * ClusterGridSize.y + tile.y) * ClusterGridSize.x + tile.x);
+}
+#endif
 
-   color += local_color * final_effect_factor * getShadowWithVSM();
+vec4 calculateLightingEquation()
+{
+   vec4 color = Material.EmissionColor + GlobalAmbient * Material.AmbientColor;
+#ifdef MULTIPLE_LIGHTS
+   for (int i = 0; i < LightNum; ++i) {
+      vec4 local_color = calculateLocalColor( Lights[i] );
+      if (local_color != vec4(zero)) color += local_color * getShadowFromAtlas( i );
+   }
+#else
+   vec4 local_color = calculateLocalColor( Lights[LightIndex] );
+   if (local_color != vec4(zero)) color += local_color * getShadowWithVSM();
+#endif
+#ifdef CLUSTERED_LIGHTS
+   // only the lights that reach the cluster of the fragment are evaluated, and they cast no shadow.
+   uint cluster = getClusterIndex();
+   uint first = cluster * MAX_LIGHTS_PER_CLUSTER;
+   for (uint i = 0; i < LightCounts[cluster]; ++i) {
+      color += calculateLocalColor( ClusteredLights[LightIndices[first + i]] );
+   }
+#endif
    return color;
 }
 
 void main()
 {
+#ifdef DEFERRED_SHADING
+   // the background is shaded as well and discarded at the end, so the derivatives stay defined around the edges.
+   bool is_covered = readGeometryBuffer();
+#endif
    final_color = bool(UseLight) ? calculateLightingEquation() : Material.DiffuseColor;
+#ifdef DEFERRED_SHADING
+   if (!is_covered) discard;
+#endif
 }
\ No newline at end of file
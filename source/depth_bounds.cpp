@@ -0,0 +1,68 @@
+#include "depth_bounds.h"
+
+DepthBoundsGL::DepthBoundsGL() :
+   Current( 0 ), Available( false ), Bounds( 0.0f ), ReductionBuffer( 0 ), ReadbackBuffer( 0 ),
+   ReadbackData( nullptr ), Fences{}
+{
+   glCreateBuffers( 1, &ReductionBuffer );
+   glNamedBufferStorage( ReductionBuffer, sizeof( GLuint ) * 2, nullptr, GL_DYNAMIC_STORAGE_BIT );
+
+   // the copies of the past frames stay mapped, and the fences tell which of them are complete.
+   constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   const auto readback_size = static_cast<GLsizeiptr>(sizeof( GLuint ) * 2 * ReadbackFrameNum);
+   glCreateBuffers( 1, &ReadbackBuffer );
+   glNamedBufferStorage( ReadbackBuffer, readback_size, nullptr, flags );
+   ReadbackData = static_cast<const GLuint*>(glMapNamedBufferRange( ReadbackBuffer, 0, readback_size, flags ));
+}
+
+DepthBoundsGL::~DepthBoundsGL()
+{
+   for (const auto& fence : Fences) {
+      if (fence != nullptr) glDeleteSync( fence );
+   }
+   glUnmapNamedBuffer( ReadbackBuffer );
+   glDeleteBuffers( 1, &ReadbackBuffer );
+   glDeleteBuffers( 1, &ReductionBuffer );
+}
+
+void DepthBoundsGL::collectBounds(int index)
+{
+   if (Fences[index] == nullptr) return;
+
+   const GLenum status = glClientWaitSync( Fences[index], 0, 0 );
+   if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) return;
+
+   glDeleteSync( Fences[index] );
+   Fences[index] = nullptr;
+
+   // the minimum stays above the maximum when no pixel shows any surface.
+   float min_depth, max_depth;
+   std::memcpy( &min_depth, ReadbackData + index * 2, sizeof( float ) );
+   std::memcpy( &max_depth, ReadbackData + index * 2 + 1, sizeof( float ) );
+   Available = min_depth <= max_depth;
+   if (Available) Bounds = glm::vec2(min_depth, max_depth);
+}
+
+void DepthBoundsGL::reduce(int width, int height)
+{
+   // the oldest copy is collected first, so the bounds end up with the latest complete one.
+   for (int i = 0; i < ReadbackFrameNum; ++i) collectBounds( (Current + i) % ReadbackFrameNum );
+   if (Fences[Current] != nullptr) {
+      glDeleteSync( Fences[Current] );
+      Fences[Current] = nullptr;
+   }
+
+   // the positive floats keep their order as unsigned integers, so the shader reduces them with the atomics.
+   const std::array<GLuint, 2> initial_bounds = { 0x7F7FFFFFu, 0u };
+   glNamedBufferSubData( ReductionBuffer, 0, sizeof( GLuint ) * 2, initial_bounds.data() );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, ReductionBuffer );
+   glDispatchCompute( (width + GroupSize - 1) / GroupSize, (height + GroupSize - 1) / GroupSize, 1 );
+   glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+
+   glCopyNamedBufferSubData(
+      ReductionBuffer, ReadbackBuffer, 0,
+      static_cast<GLintptr>(sizeof( GLuint ) * 2 * Current), sizeof( GLuint ) * 2
+   );
+   Fences[Current] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   Current = (Current + 1) % ReadbackFrameNum;
+}
\ No newline at end of file
@@ -1,10 +1,17 @@
 #include "light.h"
 
 LightGL::LightGL() :
-   TurnLightOn( true ), GlobalAmbientColor( 0.2f, 0.2f, 0.2f, 1.0f ), TotalLightNum( 0 )
+   TurnLightOn( true ), IsLightBufferUploaded( false ), TotalLightNum( 0 ), LightUBO( 0 ), LightSSBO( 0 ),
+   LightStorageCapacity( 0 ), GlobalAmbientColor( 0.2f, 0.2f, 0.2f, 1.0f ), UploadedLightBlock{}
 {
 }
 
+LightGL::~LightGL()
+{
+   if (LightUBO != 0) glDeleteBuffers( 1, &LightUBO );
+   if (LightSSBO != 0) glDeleteBuffers( 1, &LightSSBO );
+}
+
 bool LightGL::isLightOn() const
 {
    return TurnLightOn;
@@ -54,21 +61,78 @@ void LightGL::deactivateLight(const int& light_index)
    IsActivated[light_index] = false;
 }
 
-void LightGL::transferUniformsToShader(const ShaderGL* shader)
+LightGL::LightInfo LightGL::getLightInfo(int light_index, const glm::mat4& view_matrix) const
+{
+   LightInfo light{};
+   light.Position = view_matrix * Positions[light_index];
+   light.AmbientColor = AmbientColors[light_index];
+   light.DiffuseColor = DiffuseColors[light_index];
+   light.SpecularColor = SpecularColors[light_index];
+   light.SpotlightDirection = glm::normalize( glm::mat3(view_matrix) * SpotlightDirections[light_index] );
+   light.SpotlightFeather = SpotlightFeathers[light_index];
+   light.FallOffRadius = FallOffRadii[light_index];
+   light.LightSwitch = IsActivated[light_index] ? 1 : 0;
+
+   // the cutoff cosine of -1 tells the shaders that the light is not a spotlight.
+   if (SpotlightCutoffAngles[light_index] >= 180.0f) {
+      light.SpotlightCutoffCosine = -1.0f;
+      light.SpotlightCutoffAngle = glm::pi<float>();
+   }
+   else {
+      light.SpotlightCutoffAngle = glm::radians( glm::clamp( SpotlightCutoffAngles[light_index], 0.0f, 90.0f ) );
+      light.SpotlightCutoffCosine = std::cos( light.SpotlightCutoffAngle );
+   }
+   return light;
+}
+
+void LightGL::updateLightBuffer(const glm::mat4& view_matrix)
 {
-   glUniform1i( shader->getLightAvailabilityLocation(), TurnLightOn ? 1 : 0 );
-   glUniform1i( shader->getLightNumLocation(), static_cast<GLint>(TotalLightNum) );
-   glUniform4fv( shader->getGlobalAmbientLocation(), 1, &GlobalAmbientColor[0] );
-
-   for (int i = 0; i < TotalLightNum; ++i) {
-      glUniform1i( shader->getLightSwitchLocation( i ), IsActivated[0] ? 1 : 0 );
-      glUniform4fv( shader->getLightPositionLocation( i ), 1, &Positions[i][0] );
-      glUniform4fv( shader->getLightAmbientLocation( i ), 1, &AmbientColors[i][0] );
-      glUniform4fv( shader->getLightDiffuseLocation( i ), 1, &DiffuseColors[i][0] );
-      glUniform4fv( shader->getLightSpecularLocation( i ), 1, &SpecularColors[i][0] );
-      glUniform3fv( shader->getLightSpotlightDirectionLocation( i ), 1, &SpotlightDirections[i][0] );
-      glUniform1f( shader->getLightSpotlightCutoffAngleLocation( i ), SpotlightCutoffAngles[i] );
-      glUniform1f( shader->getLightSpotlightFeatherLocation( i ), SpotlightFeathers[i] );
-      glUniform1f( shader->getLightFallOffRadiusLocation( i ), FallOffRadii[i] );
+   if (LightUBO == 0) {
+      glCreateBuffers( 1, &LightUBO );
+      glNamedBufferStorage( LightUBO, sizeof( LightBlock ), nullptr, GL_DYNAMIC_STORAGE_BIT );
+      glBindBufferBase( GL_UNIFORM_BUFFER, LightBindingPoint, LightUBO );
    }
+
+   // everything per light that does not depend on the fragment is computed here once per frame,
+   // so the scene shaders neither transform the light nor evaluate the trigonometric functions for the cutoff.
+   LightBlock block{};
+   block.GlobalAmbient = GlobalAmbientColor;
+   block.UseLight = TurnLightOn ? 1 : 0;
+   block.LightNum = std::min( TotalLightNum, MaxLightNum );
+   for (int i = 0; i < block.LightNum; ++i) block.Lights[i] = getLightInfo( i, view_matrix );
+
+   // the block changes only when the camera or the lights change, so most frames do not upload anything.
+   const size_t size = offsetof( LightBlock, Lights ) + sizeof( LightInfo ) * static_cast<size_t>(block.LightNum);
+   if (IsLightBufferUploaded && std::memcmp( &UploadedLightBlock, &block, size ) == 0) return;
+
+   glNamedBufferSubData( LightUBO, 0, static_cast<GLsizeiptr>(size), &block );
+   UploadedLightBlock = block;
+   IsLightBufferUploaded = true;
+}
+
+void LightGL::updateLightStorageBuffer(const glm::mat4& view_matrix)
+{
+   // the storage buffer has no upper limit on the number of the lights, unlike LightBlock,
+   // so thousands of them can be culled by the clusters of the view frustum.
+   std::vector<LightInfo> lights(TotalLightNum);
+   for (int i = 0; i < TotalLightNum; ++i) lights[i] = getLightInfo( i, view_matrix );
+
+   if (LightStorageCapacity < TotalLightNum) {
+      if (LightSSBO != 0) glDeleteBuffers( 1, &LightSSBO );
+      LightStorageCapacity = TotalLightNum;
+      glCreateBuffers( 1, &LightSSBO );
+      glNamedBufferStorage(
+         LightSSBO, static_cast<GLsizeiptr>(sizeof( LightInfo ) * LightStorageCapacity), nullptr, GL_DYNAMIC_STORAGE_BIT
+      );
+      UploadedLightStorage.clear();
+   }
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LightStorageBindingPoint, LightSSBO );
+   if (lights.empty()) return;
+
+   const size_t size = sizeof( LightInfo ) * lights.size();
+   if (UploadedLightStorage.size() == lights.size() &&
+       std::memcmp( UploadedLightStorage.data(), lights.data(), size ) == 0) return;
+
+   glNamedBufferSubData( LightSSBO, 0, static_cast<GLsizeiptr>(size), lights.data() );
+   UploadedLightStorage = std::move( lights );
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "light_cluster.h"
+
+LightClusterGL::LightClusterGL() : LightCountBuffer( 0 ), LightIndexBuffer( 0 )
+{
+   // every cluster has a fixed range of the index list, so the culling needs no global counter.
+   glCreateBuffers( 1, &LightCountBuffer );
+   glNamedBufferStorage( LightCountBuffer, sizeof( GLuint ) * ClusterNum, nullptr, 0 );
+   glCreateBuffers( 1, &LightIndexBuffer );
+   glNamedBufferStorage(
+      LightIndexBuffer, static_cast<GLsizeiptr>(sizeof( GLuint ) * ClusterNum * MaxLightNumPerCluster), nullptr, 0
+   );
+}
+
+LightClusterGL::~LightClusterGL()
+{
+   glDeleteBuffers( 1, &LightIndexBuffer );
+   glDeleteBuffers( 1, &LightCountBuffer );
+}
+
+void LightClusterGL::cull() const
+{
+   // the buffers stay bound, so the scene shaders read the lists right after the barrier.
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LightCountBindingPoint, LightCountBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LightIndexBindingPoint, LightIndexBuffer );
+   glDispatchCompute( (ClusterNum + GroupSize - 1) / GroupSize, 1, 1 );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+}
\ No newline at end of file
@@ -3,7 +3,8 @@
 ObjectGL::ObjectGL() :
    VAO( 0 ), VBO( 0 ), IBO( 0 ), DrawMode( 0 ), VerticesCount( 0 ), EmissionColor( 0.0f, 0.0f, 0.0f, 1.0f ),
    AmbientReflectionColor( 0.2f, 0.2f, 0.2f, 1.0f ), DiffuseReflectionColor( 0.8f, 0.8f, 0.8f, 1.0f ),
-   SpecularReflectionColor( 0.0f, 0.0f, 0.0f, 1.0f ), SpecularReflectionExponent( 0.0f )
+   SpecularReflectionColor( 0.0f, 0.0f, 0.0f, 1.0f ), SpecularReflectionExponent( 0.0f ), BoundingBoxMin( 0.0f ),
+   BoundingBoxMax( 0.0f )
 {
 }
 
@@ -139,6 +140,15 @@ void ObjectGL::prepareNormal() const
 
 void ObjectGL::prepareVertexBuffer(int n_bytes_per_vertex)
 {
+   const auto stride = static_cast<size_t>(n_bytes_per_vertex / static_cast<int>(sizeof( GLfloat )));
+   BoundingBoxMin = glm::vec3(std::numeric_limits<float>::max());
+   BoundingBoxMax = glm::vec3(std::numeric_limits<float>::lowest());
+   for (size_t i = 0; i + 2 < DataBuffer.size(); i += stride) {
+      const glm::vec3 vertex(DataBuffer[i], DataBuffer[i + 1], DataBuffer[i + 2]);
+      BoundingBoxMin = glm::min( BoundingBoxMin, vertex );
+      BoundingBoxMax = glm::max( BoundingBoxMax, vertex );
+   }
+
    glCreateBuffers( 1, &VBO );
    glNamedBufferStorage( VBO, sizeof( GLfloat ) * DataBuffer.size(), DataBuffer.data(), GL_DYNAMIC_STORAGE_BIT );
 
@@ -1,18 +1,45 @@
 #include "renderer.h"
 
 RendererGL::RendererGL() :
-   Window( nullptr ), Pause( false ), FrameWidth( 1920 ), FrameHeight( 1080 ), ShadowMapSize( 1024 ),
-   ActiveLightIndex( 0 ), SplitNum( 3 ), BoxHalfSide( 500.0f ), DepthFBO( 0 ), DepthTextureID( 0 ), MomentsFBO( 0 ),
-   MomentsTextureID( 0 ), MomentsLayerFBO( 0 ), MomentsTextureArrayID( 0 ), SATTextureID( 0 ), ClickedPoint( -1, -1 ),
+   Window( nullptr ), Pause( false ), UseLayeredCascades( true ), UseShadowCache( true ),
+   UseEVSMPositiveOnly( false ), UseDeferredShading( false ), UseShadowQualityGovernor( false ), UseIntegerSAT( false ),
+   UseCascadeSAT( false ), UseTextureGather( true ), UseSampleDistribution( false ), UseCascadeAtlas( false ),
+   UseShadowedLights( false ), UseClusteredLights( false ), FrameWidth( 1920 ), FrameHeight( 1080 ),
+   ShadowMapSize( 1024 ), ActiveLightIndex( 0 ), SplitNum( 3 ), BlurRadius( 4 ), ClusteredLightNum( 1024 ),
+   ShadowCacheQueryNum( 0 ), ShadowCacheHitNum( 0 ), FrameIndex( 0 ), CascadeUpdateInterval( 4 ),
+   PCFMaxFilterSize( 32 ), SATMaxFilterSize( UnlimitedFilterSize ),
+   ShadowQualityLevelIndex( static_cast<int>(ShadowQualityLevels.size()) - 1 ), GovernorCooldownFrameNum( 0 ),
+   OverBudgetFrameNum( 0 ), UnderBudgetFrameNum( 0 ), FrameTimeBudget( 8.0 ), BoxHalfSide( 500.0f ), DepthFBO( 0 ),
+   DepthTextureID( 0 ), MomentsFBO( 0 ), MomentsTextureID( 0 ), MomentsLayerFBO( 0 ), MomentsTextureArrayID( 0 ),
+   MomentsLayeredFBO( 0 ), DepthTextureArrayID( 0 ), BlurTextureID( 0 ), IntegerSATTextureID( 0 ),
+   MomentsAtlasFBO( 0 ), MomentsAtlasTextureID( 0 ), DepthAtlasTextureID( 0 ), MomentsCubeFBO( 0 ),
+   MomentsCubeTextureID( 0 ), DepthCubeTextureID( 0 ), MomentsCubeFaceViewIDs{}, ShadowAtlasFBO( 0 ),
+   ShadowAtlasTextureID( 0 ), ShadowAtlasDepthTextureID( 0 ), GBufferFBO( 0 ), SceneDepthFBO( 0 ),
+   GBufferDepthTextureID( 0 ), GBufferNormalTextureID( 0 ), GBufferMaterialTextureID( 0 ),
+   FullScreenVAO( 0 ), MaterialUBO( 0 ), MomentsFormat( GL_RG32F ), ClickedPoint( -1, -1 ), CascadeAtlasSize( 0 ),
    Texter( std::make_unique<TextGL>() ), MainCamera( std::make_unique<CameraGL>() ),
    TextCamera( std::make_unique<CameraGL>() ), LightCamera( std::make_unique<CameraGL>() ),
-   TextShader( std::make_unique<ShaderGL>() ), PCFSceneShader( std::make_unique<ShaderGL>() ),
-   VSMSceneShader( std::make_unique<ShaderGL>() ), PSVSMSceneShader( std::make_unique<ShaderGL>() ),
-   SATVSMSceneShader( std::make_unique<ShaderGL>() ), LightViewDepthShader( std::make_unique<ShaderGL>() ),
-   LightViewMomentsShader( std::make_unique<ShaderGL>() ), LightViewMomentsArrayShader( std::make_unique<ShaderGL>() ),
-   SATShader( std::make_unique<ShaderGL>() ), Lights( std::make_unique<LightGL>() ),
+   ShaderVariants( std::make_unique<ShaderVariantCacheGL>() ), TextShader( std::make_unique<ShaderGL>() ),
+   PCFSceneShader( nullptr ), VSMSceneShader( std::make_unique<ShaderGL>() ), PSVSMSceneShader( nullptr ),
+   SATVSMSceneShader( std::make_unique<ShaderGL>() ), EVSMSceneShader( std::make_unique<ShaderGL>() ),
+   OVSMSceneShader( std::make_unique<ShaderGL>() ), DeferredPCFSceneShader( nullptr ),
+   DeferredVSMSceneShader( std::make_unique<ShaderGL>() ), DeferredPSVSMSceneShader( nullptr ),
+   DeferredSATVSMSceneShader( std::make_unique<ShaderGL>() ), DeferredEVSMSceneShader( std::make_unique<ShaderGL>() ),
+   DeferredOVSMSceneShader( std::make_unique<ShaderGL>() ),
+   ShadowedLightsSceneShader( std::make_unique<ShaderGL>() ),
+   DeferredShadowedLightsSceneShader( std::make_unique<ShaderGL>() ), ClusteredLightsSceneShader( nullptr ),
+   DeferredClusteredLightsSceneShader( nullptr ), GBufferShader( std::make_unique<ShaderGL>() ),
+   LightViewDepthShader( std::make_unique<ShaderGL>() ), LightViewMomentsShader( std::make_unique<ShaderGL>() ),
+   LightViewDistanceMomentsShader( std::make_unique<ShaderGL>() ),
+   LightViewMomentsArrayShader( nullptr ), LightViewMomentsLayeredShader( nullptr ),
+   LightViewExponentialMomentsShader( std::make_unique<ShaderGL>() ),
+   LightViewCubeMomentsShader( std::make_unique<ShaderGL>() ), SATShader( std::make_unique<ShaderGL>() ),
+   IntegerSATShader( std::make_unique<ShaderGL>() ), CascadeSATShader( std::make_unique<ShaderGL>() ),
+   MomentsBlurShader( std::make_unique<ShaderGL>() ), DepthBoundsShader( std::make_unique<ShaderGL>() ),
+   LightCullingShader( std::make_unique<ShaderGL>() ), Lights( std::make_unique<LightGL>() ),
    Object( std::make_unique<ObjectGL>() ), WallObject( std::make_unique<ObjectGL>() ),
-   AlgorithmToCompare( ALGORITHM_TO_COMPARE::SATVSM )
+   PointLightFarPlane( 1.0f ), AlgorithmToCompare( ALGORITHM_TO_COMPARE::SATVSM ),
+   MomentsPrecision( MOMENTS_PRECISION::RG32F )
 {
    Renderer = this;
 
@@ -22,13 +49,9 @@ RendererGL::RendererGL() :
 
 RendererGL::~RendererGL()
 {
-   if (DepthTextureID != 0) glDeleteTextures( 1, &DepthTextureID );
-   if (MomentsTextureID != 0) glDeleteTextures( 1, &MomentsTextureID );
-   if (MomentsTextureArrayID != 0) glDeleteTextures( 1, &MomentsTextureArrayID );
-   if (SATTextureID != 0) glDeleteTextures( 1, &SATTextureID );
-   if (DepthFBO != 0) glDeleteFramebuffers( 1, &DepthFBO );
-   if (MomentsFBO != 0) glDeleteFramebuffers( 1, &MomentsFBO );
-   if (MomentsLayerFBO != 0) glDeleteFramebuffers( 1, &MomentsLayerFBO );
+   deleteLightViewFrameBuffers();
+   deleteGeometryBuffers();
+   deleteShadowAtlas();
 }
 
 void RendererGL::printOpenGLInformation()
@@ -60,40 +83,84 @@ void RendererGL::initialize()
       std::cout << "Failed to initialize GLAD" << std::endl;
       return;
    }
+   ShaderGL::enableParallelCompile();
 
    registerCallbacks();
 
    glEnable( GL_CULL_FACE );
    glEnable( GL_DEPTH_TEST );
+   glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
    glClearColor( 0.094, 0.07f, 0.17f, 1.0f );
 
    Texter->initialize( 30.0f );
+   LightPassTimer = std::make_unique<TimerGL>();
+   ScenePassTimer = std::make_unique<TimerGL>();
+   SceneDepthBounds = std::make_unique<DepthBoundsGL>();
+   LightClusters = std::make_unique<LightClusterGL>();
 
    TextCamera->update2DCamera( FrameWidth, FrameHeight );
    MainCamera->updatePerspectiveCamera( FrameWidth, FrameHeight );
-   LightCamera->updateOrthographicCamera( ShadowMapSize, ShadowMapSize );
+   LightCamera->updateOrthographicCamera( LightViewExtent, LightViewExtent );
 
+   // every program is submitted before any of them is waited on, so the driver compiles them all concurrently.
    const std::string shader_directory_path = std::string(CMAKE_SOURCE_DIR) + "/shaders";
+   const ShaderGL::DefineSet scene_defines = getSceneShaderDefines();
+   const std::array<ShaderGL*, 10> scene_shaders = {
+      VSMSceneShader.get(), SATVSMSceneShader.get(), EVSMSceneShader.get(), OVSMSceneShader.get(),
+      DeferredVSMSceneShader.get(), DeferredSATVSMSceneShader.get(), DeferredEVSMSceneShader.get(),
+      DeferredOVSMSceneShader.get(), ShadowedLightsSceneShader.get(), DeferredShadowedLightsSceneShader.get()
+   };
+   for (const auto& scene_shader : scene_shaders) scene_shader->addDefines( scene_defines );
    TextShader->setShader(
       std::string(shader_directory_path + "/text.vert").c_str(),
       std::string(shader_directory_path + "/text.frag").c_str()
    );
-   PCFSceneShader->setShader(
-      std::string(shader_directory_path + "/pcf/scene_shader.vert").c_str(),
-      std::string(shader_directory_path + "/pcf/scene_shader.frag").c_str()
-   );
    VSMSceneShader->setShader(
       std::string(shader_directory_path + "/vsm/scene_shader.vert").c_str(),
       std::string(shader_directory_path + "/vsm/scene_shader.frag").c_str()
    );
-   PSVSMSceneShader->setShader(
-      std::string(shader_directory_path + "/psvsm/scene_shader.vert").c_str(),
-      std::string(shader_directory_path + "/psvsm/scene_shader.frag").c_str()
-   );
    SATVSMSceneShader->setShader(
       std::string(shader_directory_path + "/satvsm/scene_shader.vert").c_str(),
       std::string(shader_directory_path + "/satvsm/scene_shader.frag").c_str()
    );
+   EVSMSceneShader->setShader(
+      std::string(shader_directory_path + "/evsm/scene_shader.vert").c_str(),
+      std::string(shader_directory_path + "/evsm/scene_shader.frag").c_str()
+   );
+   OVSMSceneShader->setShader(
+      std::string(shader_directory_path + "/ovsm/scene_shader.vert").c_str(),
+      std::string(shader_directory_path + "/ovsm/scene_shader.frag").c_str()
+   );
+
+   // the deferred scene shaders evaluate the same lighting and shadows once per pixel from the geometry buffers.
+   const std::array<std::pair<ShaderGL*, std::string>, 4> deferred_scene_shaders = {
+      std::make_pair( DeferredVSMSceneShader.get(), "/vsm/scene_shader.frag" ),
+      std::make_pair( DeferredSATVSMSceneShader.get(), "/satvsm/scene_shader.frag" ),
+      std::make_pair( DeferredEVSMSceneShader.get(), "/evsm/scene_shader.frag" ),
+      std::make_pair( DeferredOVSMSceneShader.get(), "/ovsm/scene_shader.frag" )
+   };
+   for (const auto& deferred_scene_shader : deferred_scene_shaders) {
+      deferred_scene_shader.first->addDefine( "DEFERRED_SHADING" );
+      deferred_scene_shader.first->setShader(
+         std::string(shader_directory_path + "/deferred/full_screen.vert").c_str(),
+         std::string(shader_directory_path + deferred_scene_shader.second).c_str()
+      );
+   }
+   ShadowedLightsSceneShader->addDefine( "MULTIPLE_LIGHTS" );
+   ShadowedLightsSceneShader->setShader(
+      std::string(shader_directory_path + "/vsm/scene_shader.vert").c_str(),
+      std::string(shader_directory_path + "/vsm/scene_shader.frag").c_str()
+   );
+   DeferredShadowedLightsSceneShader->addDefine( "DEFERRED_SHADING" );
+   DeferredShadowedLightsSceneShader->addDefine( "MULTIPLE_LIGHTS" );
+   DeferredShadowedLightsSceneShader->setShader(
+      std::string(shader_directory_path + "/deferred/full_screen.vert").c_str(),
+      std::string(shader_directory_path + "/vsm/scene_shader.frag").c_str()
+   );
+   GBufferShader->setShader(
+      std::string(shader_directory_path + "/deferred/gbuffer_generator.vert").c_str(),
+      std::string(shader_directory_path + "/deferred/gbuffer_generator.frag").c_str()
+   );
    LightViewDepthShader->setShader(
       std::string(shader_directory_path + "/depth/light_view_depth_generator.vert").c_str(),
       std::string(shader_directory_path + "/depth/light_view_depth_generator.frag").c_str()
@@ -102,11 +169,213 @@ void RendererGL::initialize()
       std::string(shader_directory_path + "/depth/light_view_moments_generator.vert").c_str(),
       std::string(shader_directory_path + "/depth/light_view_moments_generator.frag").c_str()
    );
-   LightViewMomentsArrayShader->setShader(
-      std::string(shader_directory_path + "/depth/light_view_moments_array_generator.vert").c_str(),
-      std::string(shader_directory_path + "/depth/light_view_moments_array_generator.frag").c_str()
+   LightViewDistanceMomentsShader->addDefine( "LIGHT_DISTANCE" );
+   LightViewDistanceMomentsShader->setShader(
+      std::string(shader_directory_path + "/depth/light_view_moments_generator.vert").c_str(),
+      std::string(shader_directory_path + "/depth/light_view_moments_generator.frag").c_str()
+   );
+   LightViewExponentialMomentsShader->setShader(
+      std::string(shader_directory_path + "/depth/light_view_exponential_moments_generator.vert").c_str(),
+      std::string(shader_directory_path + "/depth/light_view_exponential_moments_generator.frag").c_str()
    );
+   LightViewCubeMomentsShader->setShader(
+      std::string(shader_directory_path + "/depth/light_view_moments_layered_generator.vert").c_str(),
+      std::string(shader_directory_path + "/depth/light_view_cube_moments_generator.frag").c_str(),
+      std::string(shader_directory_path + "/depth/light_view_cube_moments_generator.geom").c_str()
+   );
+   const ShaderGL::DefineSet sat_defines = getSATShaderDefines();
+   SATShader->addDefines( sat_defines );
    SATShader->setComputeShader( std::string(shader_directory_path + "/satvsm/sat_generator.comp").c_str() );
+   IntegerSATShader->addDefines( sat_defines );
+   IntegerSATShader->addDefine( "INTEGER_SAT" );
+   IntegerSATShader->setComputeShader( std::string(shader_directory_path + "/satvsm/sat_generator.comp").c_str() );
+   CascadeSATShader->addDefines( sat_defines );
+   CascadeSATShader->addDefine( "LAYERED" );
+   CascadeSATShader->setComputeShader( std::string(shader_directory_path + "/satvsm/sat_generator.comp").c_str() );
+   MomentsBlurShader->addDefine( "MAX_RADIUS", MaxBlurRadius );
+   MomentsBlurShader->addDefine( "GROUP_SIZE", BlurGroupSize );
+   MomentsBlurShader->setComputeShader( std::string(shader_directory_path + "/vsm/moments_blur.comp").c_str() );
+   DepthBoundsShader->addDefine( "GROUP_SIZE", DepthBoundsGL::getGroupSize() );
+   DepthBoundsShader->setComputeShader( std::string(shader_directory_path + "/psvsm/depth_bounds.comp").c_str() );
+   LightCullingShader->addDefine( "GROUP_SIZE", LightClusterGL::getGroupSize() );
+   LightCullingShader->addDefine( "MAX_LIGHTS_PER_CLUSTER", LightClusterGL::getMaxLightNumPerCluster() );
+   LightCullingShader->setComputeShader( std::string(shader_directory_path + "/vsm/light_culling.comp").c_str() );
+
+   // the pcf shaders of every quality level are built up front, so the governor switches between them for free.
+   std::vector<ShaderGL*> shaders = {
+      TextShader.get(), VSMSceneShader.get(), SATVSMSceneShader.get(), EVSMSceneShader.get(), OVSMSceneShader.get(),
+      DeferredVSMSceneShader.get(), DeferredSATVSMSceneShader.get(), DeferredEVSMSceneShader.get(),
+      DeferredOVSMSceneShader.get(), ShadowedLightsSceneShader.get(), DeferredShadowedLightsSceneShader.get(),
+      GBufferShader.get(), LightViewDepthShader.get(), LightViewMomentsShader.get(),
+      LightViewDistanceMomentsShader.get(), LightViewExponentialMomentsShader.get(), LightViewCubeMomentsShader.get(),
+      SATShader.get(), IntegerSATShader.get(), CascadeSATShader.get(), MomentsBlurShader.get(),
+      DepthBoundsShader.get(), LightCullingShader.get()
+   };
+   for (const auto& level : ShadowQualityLevels) {
+      shaders.emplace_back( getPCFSceneShader( level.PCFMaxFilterSize, false ) );
+      shaders.emplace_back( getPCFSceneShader( level.PCFMaxFilterSize, true ) );
+   }
+   setCascadeShaders();
+   ShaderGL::finishAll( shaders );
+   setPCFShaders();
+}
+
+ShaderGL::DefineSet RendererGL::getSceneShaderDefines()
+{
+   return {
+      { "MAX_LIGHTS", std::to_string( LightGL::getMaxLightNum() ) },
+      { "MAX_MATERIALS", std::to_string( MaxMaterialNum ) },
+      { "MAX_LIGHTS_PER_CLUSTER", std::to_string( LightClusterGL::getMaxLightNumPerCluster() ) },
+      { "SHADOW_MAP_BORDER", ShaderGL::getFloatLiteral( ShadowMapBorder ) },
+      { "SAT_SHADOW_MAP_BORDER", ShaderGL::getFloatLiteral( SATShadowMapBorder ) },
+      { "SAT_MIN_VARIANCE", ShaderGL::getFloatLiteral( SATMinVariance ) },
+      { "LIGHT_BLEEDING_REDUCTION", ShaderGL::getFloatLiteral( LightBleedingReduction ) },
+      { "PCF_DEPTH_BIAS", ShaderGL::getFloatLiteral( PCFDepthBias ) }
+   };
+}
+
+ShaderGL* RendererGL::getPCFSceneShader(int max_filter_size, bool deferred_shading)
+{
+   const std::string shader_directory_path = std::string(CMAKE_SOURCE_DIR) + "/shaders";
+   ShaderGL::DefineSet defines = getSceneShaderDefines();
+   defines["PCF_MAX_FILTER_SIZE"] = std::to_string( max_filter_size );
+   if (!deferred_shading) {
+      return ShaderVariants->getShader(
+         defines, shader_directory_path + "/pcf/scene_shader.vert", shader_directory_path + "/pcf/scene_shader.frag"
+      );
+   }
+   defines["DEFERRED_SHADING"] = "";
+   return ShaderVariants->getShader(
+      defines, shader_directory_path + "/deferred/full_screen.vert", shader_directory_path + "/pcf/scene_shader.frag"
+   );
+}
+
+void RendererGL::setPCFShaders()
+{
+   // the filter loops of the pcf shaders are bounded by the largest filter size of the quality level in use,
+   // so each level has its own variants.
+   PCFSceneShader = getPCFSceneShader( PCFMaxFilterSize, false );
+   DeferredPCFSceneShader = getPCFSceneShader( PCFMaxFilterSize, true );
+   ShaderGL::finishAll( { PCFSceneShader, DeferredPCFSceneShader } );
+}
+
+void RendererGL::setClusteredLightsShaders()
+{
+   // the clustered lights are added to the sun or to the shadowed lights, whichever the scene shader evaluates,
+   // so these shaders are chosen again when the shadowed lights are toggled.
+   const std::string shader_directory_path = std::string(CMAKE_SOURCE_DIR) + "/shaders";
+   ShaderGL::DefineSet defines = getSceneShaderDefines();
+   defines["CLUSTERED_LIGHTS"] = "";
+   if (UseShadowedLights) defines["MULTIPLE_LIGHTS"] = "";
+   ClusteredLightsSceneShader = ShaderVariants->getShader(
+      defines, shader_directory_path + "/vsm/scene_shader.vert", shader_directory_path + "/vsm/scene_shader.frag"
+   );
+
+   defines["DEFERRED_SHADING"] = "";
+   DeferredClusteredLightsSceneShader = ShaderVariants->getShader(
+      defines, shader_directory_path + "/deferred/full_screen.vert", shader_directory_path + "/vsm/scene_shader.frag"
+   );
+   ShaderGL::finishAll( { ClusteredLightsSceneShader, DeferredClusteredLightsSceneShader } );
+}
+
+void RendererGL::setCascadeShaders()
+{
+   // the number of the splits sizes the uniform arrays and the geometry shader invocations, and the layout of
+   // the cascades decides what the shaders sample and render into, so these shaders are chosen again whenever
+   // either of them changes. the variants already built for a previous configuration are reused.
+   const std::string shader_directory_path = std::string(CMAKE_SOURCE_DIR) + "/shaders";
+   ShaderGL::DefineSet defines = { { "SPLIT_NUM", std::to_string( SplitNum ) } };
+   LightViewMomentsArrayShader = ShaderVariants->getShader(
+      defines,
+      shader_directory_path + "/depth/light_view_moments_array_generator.vert",
+      shader_directory_path + "/depth/light_view_moments_array_generator.frag"
+   );
+
+   if (UseCascadeAtlas) defines["ATLAS"] = "";
+   LightViewMomentsLayeredShader = ShaderVariants->getShader(
+      defines,
+      shader_directory_path + "/depth/light_view_moments_layered_generator.vert",
+      shader_directory_path + "/depth/light_view_moments_layered_generator.frag",
+      shader_directory_path + "/depth/light_view_moments_layered_generator.geom"
+   );
+
+   const ShaderGL::DefineSet scene_defines = getSceneShaderDefines();
+   defines.insert( scene_defines.begin(), scene_defines.end() );
+   PSVSMSceneShader = ShaderVariants->getShader(
+      defines, shader_directory_path + "/psvsm/scene_shader.vert", shader_directory_path + "/psvsm/scene_shader.frag"
+   );
+
+   defines["DEFERRED_SHADING"] = "";
+   DeferredPSVSMSceneShader = ShaderVariants->getShader(
+      defines,
+      shader_directory_path + "/deferred/full_screen.vert",
+      shader_directory_path + "/psvsm/scene_shader.frag"
+   );
+   ShaderGL::finishAll(
+      {
+         PSVSMSceneShader, DeferredPSVSMSceneShader,
+         LightViewMomentsArrayShader, LightViewMomentsLayeredShader
+      }
+   );
+}
+
+ShaderGL::DefineSet RendererGL::getSATShaderDefines()
+{
+   ShaderGL::DefineSet defines = { { "TILE_SIZE", std::to_string( ThreadGroupSize ) } };
+   if (isSubgroupScanSupported()) defines["USE_SUBGROUP"] = "";
+   return defines;
+}
+
+bool RendererGL::isSubgroupScanSupported()
+{
+   // the core profile header does not have KHR_shader_subgroup, so its tokens are defined here.
+   constexpr GLenum subgroup_size = 0x9532;
+   constexpr GLenum subgroup_supported_stages = 0x9533;
+   constexpr GLenum subgroup_supported_features = 0x9534;
+   constexpr GLint subgroup_feature_arithmetic_bit = 0x4;
+   constexpr GLint subgroup_feature_ballot_bit = 0x8;
+
+   GLint extension_num = 0;
+   glGetIntegerv( GL_NUM_EXTENSIONS, &extension_num );
+   bool is_supported = false;
+   for (int i = 0; i < extension_num && !is_supported; ++i) {
+      const auto* extension = reinterpret_cast<const char*>(glGetStringi( GL_EXTENSIONS, i ));
+      is_supported = std::strcmp( extension, "GL_KHR_shader_subgroup" ) == 0;
+   }
+   if (!is_supported) return false;
+
+   // the scan of sat_generator.comp expects that one subgroup holds exactly one line of its tile.
+   GLint size = 0, stages = 0, features = 0;
+   glGetIntegerv( subgroup_size, &size );
+   glGetIntegerv( subgroup_supported_stages, &stages );
+   glGetIntegerv( subgroup_supported_features, &features );
+   return size == ThreadGroupSize && (stages & GL_COMPUTE_SHADER_BIT) != 0 &&
+      (features & subgroup_feature_arithmetic_bit) != 0 && (features & subgroup_feature_ballot_bit) != 0;
+}
+
+int RendererGL::getBytesPerTexel(GLenum format)
+{
+   switch (format) {
+      case GL_RG32F: return 8;
+      case GL_RG32UI: return 8;
+      case GL_RG16F: return 4;
+      case GL_RG16: return 4;
+      case GL_RGBA16F: return 8;
+      case GL_DEPTH_COMPONENT32F: return 4;
+      default: return 0;
+   }
+}
+
+std::string RendererGL::getFormatString(GLenum format)
+{
+   switch (format) {
+      case GL_RG32F: return "RG32F";
+      case GL_RG16F: return "RG16F";
+      case GL_RG16: return "RG16";
+      case GL_RGBA16F: return "RGBA16F";
+      case GL_DEPTH_COMPONENT32F: return "DEPTH32F";
+      default: return "";
+   }
 }
 
 void RendererGL::writeFrame() const
@@ -130,18 +399,31 @@ void RendererGL::writeSATTexture() const
    const int size = ShadowMapSize * ShadowMapSize;
    auto* buffer = new uint8_t[size];
    auto* raw_buffer = new GLfloat[size * 2];
-   glBindFramebuffer( GL_FRAMEBUFFER, MomentsFBO );
-   glNamedFramebufferReadBuffer( MomentsFBO, GL_COLOR_ATTACHMENT0 );
-   glReadPixels( 0, 0, ShadowMapSize, ShadowMapSize, GL_RG, GL_FLOAT, raw_buffer );
+   if (UseIntegerSAT) {
+      // the wrapped sums are read as they are stored, so the image shows the signed sums of the deviations.
+      glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT );
+      std::vector<GLuint> integer_buffer(size * 2);
+      glGetTextureImage(
+         IntegerSATTextureID, 0, GL_RG_INTEGER, GL_UNSIGNED_INT,
+         static_cast<GLsizei>(integer_buffer.size() * sizeof( GLuint )), integer_buffer.data()
+      );
+      for (int i = 0; i < size * 2; ++i) raw_buffer[i] = static_cast<float>(static_cast<int32_t>(integer_buffer[i]));
+   }
+   else {
+      glBindFramebuffer( GL_FRAMEBUFFER, MomentsFBO );
+      glNamedFramebufferReadBuffer( MomentsFBO, GL_COLOR_ATTACHMENT0 );
+      glReadPixels( 0, 0, ShadowMapSize, ShadowMapSize, GL_RG, GL_FLOAT, raw_buffer );
+   }
 
-   float max_value = 0.0f;
+   float min_value = raw_buffer[0], max_value = raw_buffer[0];
    for (int i = 0; i < size; ++i) {
+      min_value = std::min( min_value, raw_buffer[i * 2] );
       max_value = std::max( max_value, raw_buffer[i * 2] );
    }
 
-   const float inv_max_value = max_value > 0.0f ? 255.0f / max_value : 0.0f;
+   const float inv_range = max_value > min_value ? 255.0f / (max_value - min_value) : 0.0f;
    for (int i = 0; i < size; ++i) {
-      buffer[i] = static_cast<uint8_t>(raw_buffer[i * 2] * inv_max_value);
+      buffer[i] = static_cast<uint8_t>((raw_buffer[i * 2] - min_value) * inv_range);
    }
 
    FIBITMAP* image = FreeImage_ConvertFromRawBits(
@@ -154,22 +436,184 @@ void RendererGL::writeSATTexture() const
    delete [] buffer;
 }
 
+void RendererGL::validateSummedAreaTable()
+{
+   // the moments are drawn again because the float table replaces them in place.
+   drawMomentsMapFromLightView();
+   const auto texel_num = static_cast<size_t>(ShadowMapSize) * static_cast<size_t>(ShadowMapSize);
+   const auto moments_bytes = static_cast<GLsizei>(texel_num * 2 * sizeof( GLfloat ));
+   std::vector<float> moments(texel_num * 2);
+   glGetTextureImage( MomentsTextureID, 0, GL_RG, GL_FLOAT, moments_bytes, moments.data() );
+   generateSummedAreaTable();
+   CachedShadowMapState.IsValid = false;
+
+   std::cout << ">> SAT Validation (" << ShadowMapSize << "x" << ShadowMapSize << ", ";
+   std::cout << SummedAreaTable::getInstructionSetName() << ", " << SummedAreaTable().getThreadNum() << " threads)\n";
+   const bool passed = checkSummedAreaTable(
+      moments, ShadowMapSize, getSATMaxFilterSize( UseIntegerSAT ), MomentsTextureID,
+      UseIntegerSAT ? IntegerSATTextureID : 0
+   );
+   std::cout << ">>   " << (passed ? "Passed\n" : "FAILED\n");
+}
+
+bool RendererGL::checkSummedAreaTable(
+   const std::vector<float>& moments,
+   int size,
+   int max_filter_size,
+   GLuint moments_texture_id,
+   GLuint integer_sat_texture_id
+)
+{
+   // the float table is read from the moments map that it replaced, and the fixed-point one from its own texture.
+   glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT );
+   const auto texel_num = static_cast<size_t>(size) * static_cast<size_t>(size);
+   const SummedAreaTable cpu_table_builder;
+   const std::vector<double> reference = SummedAreaTable::getReferenceTable( moments, size );
+   if (integer_sat_texture_id != 0) {
+      // the cpu conversion takes the same mean as the gpu, so the two tables should be identical bit by bit.
+      glm::vec2 mean;
+      glGetTextureImage(
+         moments_texture_id, getMipLevelNum( size ) - 1, GL_RG, GL_FLOAT, sizeof( mean ), glm::value_ptr( mean )
+      );
+      std::vector<uint32_t> gpu_table(texel_num * 2);
+      glGetTextureImage(
+         integer_sat_texture_id, 0, GL_RG_INTEGER, GL_UNSIGNED_INT,
+         static_cast<GLsizei>(gpu_table.size() * sizeof( uint32_t )), gpu_table.data()
+      );
+      std::vector<uint32_t> cpu_table =
+         SummedAreaTable::getFixedPointMoments( moments, mean, IntegerSATFractionBits );
+      cpu_table_builder.build( cpu_table, size );
+
+      size_t mismatch_num = 0;
+      for (size_t i = 0; i < gpu_table.size(); ++i) {
+         if (gpu_table[i] != cpu_table[i]) mismatch_num++;
+      }
+      std::cout << ">>   RG32UI error: GPU " << SummedAreaTable::getMaxAreaError(
+         gpu_table, reference, size, max_filter_size, mean, IntegerSATFractionBits
+      );
+      std::cout << ", CPU " << SummedAreaTable::getMaxAreaError(
+         cpu_table, reference, size, max_filter_size, mean, IntegerSATFractionBits
+      );
+      std::cout << ", " << mismatch_num << " texels differ\n";
+      return mismatch_num == 0;
+   }
+
+   std::vector<float> gpu_table(texel_num * 2);
+   glGetTextureImage(
+      moments_texture_id, 0, GL_RG, GL_FLOAT, static_cast<GLsizei>(gpu_table.size() * sizeof( GLfloat )),
+      gpu_table.data()
+   );
+   std::vector<float> cpu_table = moments;
+   cpu_table_builder.build( cpu_table, size );
+
+   // the gpu adds in another order than the cpu, so it is held to the bound of the float rounding instead.
+   const double filter_error =
+      SummedAreaTable::getMaxAreaError( gpu_table, reference, size, max_filter_size, max_filter_size );
+   const double error_bound = SummedAreaTable::getFloatErrorBound( size, max_filter_size );
+   std::cout << ">>   RG32F error: GPU ";
+   std::cout << SummedAreaTable::getMaxAreaError( gpu_table, reference, size, max_filter_size );
+   std::cout << ", CPU " << SummedAreaTable::getMaxAreaError( cpu_table, reference, size, max_filter_size );
+   std::cout << ", GPU at " << max_filter_size << "x" << max_filter_size << " " << filter_error;
+   std::cout << " (bound " << error_bound << ")\n";
+   return filter_error <= error_bound;
+}
+
+bool RendererGL::validateSummedAreaTableOnGPU()
+{
+   // the compute shaders run in a hidden window on whatever gl the machine has, so a software one such as
+   // llvmpipe checks them against the cpu tables without any gpu.
+   if (!glfwInit()) {
+      std::cerr << "Cannot Initialize OpenGL...\n";
+      return false;
+   }
+   glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 4 );
+   glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 6 );
+   glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+   glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+   GLFWwindow* window = glfwCreateWindow( 64, 64, "Summed Area Table Validation", nullptr, nullptr );
+   if (window == nullptr) {
+      std::cerr << "Cannot Create an OpenGL 4.6 Context\n";
+      glfwTerminate();
+      return false;
+   }
+   glfwMakeContextCurrent( window );
+   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+      std::cerr << "Failed to initialize GLAD\n";
+      glfwTerminate();
+      return false;
+   }
+
+   bool passed = true;
+   std::cout << "===================== Summed Area Table GPU Validation =====================\n";
+   std::cout << ">> " << glGetString( GL_RENDERER ) << ", " << glGetString( GL_VERSION ) << "\n";
+   {
+      const std::string shader_directory_path = std::string(CMAKE_SOURCE_DIR) + "/shaders";
+      const ShaderGL::DefineSet sat_defines = getSATShaderDefines();
+      ShaderGL sat_shader( sat_defines );
+      ShaderGL integer_sat_shader( sat_defines );
+      integer_sat_shader.addDefine( "INTEGER_SAT" );
+      sat_shader.setComputeShader( std::string(shader_directory_path + "/satvsm/sat_generator.comp").c_str() );
+      integer_sat_shader.setComputeShader(
+         std::string(shader_directory_path + "/satvsm/sat_generator.comp").c_str()
+      );
+      ShaderGL::finishAll( { &sat_shader, &integer_sat_shader } );
+
+      // the odd size leaves partial work groups and chunks at the ends of the lines.
+      std::mt19937 generator( 11 );
+      std::uniform_real_distribution<float> depth_distribution( 0.0f, 1.0f );
+      for (const int size : { 1027, 2048 }) {
+         std::vector<float> moments(static_cast<size_t>(size) * size * 2);
+         for (size_t i = 0; i < moments.size(); i += 2) {
+            const float depth = depth_distribution( generator );
+            moments[i] = depth;
+            moments[i + 1] = depth * depth;
+         }
+
+         GLuint moments_texture_id = 0, integer_sat_texture_id = 0;
+         glCreateTextures( GL_TEXTURE_2D, 1, &moments_texture_id );
+         glTextureStorage2D( moments_texture_id, getMipLevelNum( size ), GL_RG32F, size, size );
+         glTextureSubImage2D( moments_texture_id, 0, 0, 0, size, size, GL_RG, GL_FLOAT, moments.data() );
+         glCreateTextures( GL_TEXTURE_2D, 1, &integer_sat_texture_id );
+         glTextureStorage2D( integer_sat_texture_id, 1, GL_RG32UI, size, size );
+
+         // the fixed-point table only reads the moments map, so the float table can replace it afterwards.
+         std::cout << ">> " << size << "x" << size << "\n";
+         dispatchSummedAreaTable( &integer_sat_shader, size, moments_texture_id, integer_sat_texture_id );
+         const bool is_exact =
+            checkSummedAreaTable( moments, size, IntegerSATMaxFilterSize, moments_texture_id, integer_sat_texture_id );
+         dispatchSummedAreaTable( &sat_shader, size, moments_texture_id, 0 );
+         const bool is_accurate = checkSummedAreaTable( moments, size, IntegerSATMaxFilterSize, moments_texture_id, 0 );
+         passed = passed && is_exact && is_accurate;
+
+         glDeleteTextures( 1, &moments_texture_id );
+         glDeleteTextures( 1, &integer_sat_texture_id );
+      }
+   }
+   std::cout << ">> " << (passed ? "Passed\n" : "FAILED\n");
+   std::cout << "============================================================================\n";
+   glfwDestroyWindow( window );
+   glfwTerminate();
+   return passed;
+}
+
 void RendererGL::writeMomentsArrayTexture() const
 {
-   const int size = ShadowMapSize * ShadowMapSize;
-   auto* buffer = new uint8_t[size];
-   auto* raw_buffer = new GLfloat[size * 2];
-   glBindFramebuffer( GL_FRAMEBUFFER, MomentsLayerFBO );
+   auto* buffer = new uint8_t[ShadowMapSize * ShadowMapSize];
+   auto* raw_buffer = new GLfloat[ShadowMapSize * ShadowMapSize * 2];
+   glBindFramebuffer( GL_FRAMEBUFFER, UseCascadeAtlas ? MomentsAtlasFBO : MomentsLayerFBO );
    for (int s = 0; s < SplitNum; ++s) {
-      glNamedFramebufferReadBuffer( MomentsLayerFBO, GL_COLOR_ATTACHMENT0 + s );
-      glReadPixels( 0, 0, ShadowMapSize, ShadowMapSize, GL_RG, GL_FLOAT, raw_buffer );
+      // the tiles of the atlas are read one by one, so each split is captured at its own resolution.
+      const glm::ivec4 tile = UseCascadeAtlas ? CascadeAtlasTiles[s] : glm::ivec4(0, 0, ShadowMapSize, ShadowMapSize);
+      if (!UseCascadeAtlas) glNamedFramebufferReadBuffer( MomentsLayerFBO, GL_COLOR_ATTACHMENT0 + s );
+      glReadPixels( tile.x, tile.y, tile.z, tile.w, GL_RG, GL_FLOAT, raw_buffer );
 
+      const int size = tile.z * tile.w;
       for (int i = 0; i < size; ++i) {
          buffer[i] = static_cast<uint8_t>(LightCamera->linearizeDepthValue( raw_buffer[i * 2] ) * 255.0f);
       }
 
       FIBITMAP* image = FreeImage_ConvertFromRawBits(
-         buffer, ShadowMapSize, ShadowMapSize, ShadowMapSize, 8,
+         buffer, tile.z, tile.w, tile.z, 8,
          FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, false
       );
       FreeImage_Save( FIF_PNG, image, std::string("../moments" + std::to_string( s ) + ".png").c_str() );
@@ -191,28 +635,147 @@ void RendererGL::keyboard(GLFWwindow* window, int key, int scancode, int action,
    switch (key) {
       case GLFW_KEY_1:
          if (!Renderer->Pause) {
-            Renderer->AlgorithmToCompare = ALGORITHM_TO_COMPARE::PCF;
+            Renderer->setAlgorithmToCompare( ALGORITHM_TO_COMPARE::PCF );
             std::cout << ">> Percentage-Closer Filtering Selected\n";
          }
          break;
       case GLFW_KEY_2:
          if (!Renderer->Pause) {
-            Renderer->AlgorithmToCompare = ALGORITHM_TO_COMPARE::VSM;
+            Renderer->setAlgorithmToCompare( ALGORITHM_TO_COMPARE::VSM );
             std::cout << ">> Variance Shadow Map Selected\n";
          }
          break;
       case GLFW_KEY_3:
          if (!Renderer->Pause) {
-            Renderer->AlgorithmToCompare = ALGORITHM_TO_COMPARE::PSVSM;
+            Renderer->setAlgorithmToCompare( ALGORITHM_TO_COMPARE::PSVSM );
             std::cout << ">> Parallel-Split Variance Shadow Map Selected\n";
          }
          break;
       case GLFW_KEY_4:
          if (!Renderer->Pause) {
-            Renderer->AlgorithmToCompare = ALGORITHM_TO_COMPARE::SATVSM;
+            Renderer->setAlgorithmToCompare( ALGORITHM_TO_COMPARE::SATVSM );
             std::cout << ">> Summed Area Table Variance Shadow Map Selected\n";
          }
          break;
+      case GLFW_KEY_5:
+         if (!Renderer->Pause) {
+            Renderer->setAlgorithmToCompare( ALGORITHM_TO_COMPARE::EVSM );
+            std::cout << ">> Exponential Variance Shadow Map Selected\n";
+         }
+         break;
+      case GLFW_KEY_6:
+         if (!Renderer->Pause) {
+            Renderer->setAlgorithmToCompare( ALGORITHM_TO_COMPARE::OVSM );
+            std::cout << ">> Omnidirectional Variance Shadow Map Selected\n";
+         }
+         break;
+      case GLFW_KEY_V:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) Renderer->validateSummedAreaTable();
+         break;
+      case GLFW_KEY_A:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM && !Renderer->UseCascadeAtlas) {
+            Renderer->UseCascadeSAT = !Renderer->UseCascadeSAT;
+            std::cout << ">> Summed Area Table Cascades " << (Renderer->UseCascadeSAT ? "On!\n" : "Off!\n");
+         }
+         break;
+      case GLFW_KEY_H:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM) {
+            Renderer->setShadowedLights( !Renderer->UseShadowedLights );
+         }
+         break;
+      case GLFW_KEY_X:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM) {
+            Renderer->setClusteredLights( !Renderer->UseClusteredLights );
+         }
+         break;
+      case GLFW_KEY_Y:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM && Renderer->UseClusteredLights) {
+            Renderer->ClusteredLightNum = Renderer->ClusteredLightNum >= MaxClusteredLightNum ?
+               MinClusteredLightNum : Renderer->ClusteredLightNum * 2;
+            Renderer->setClusteredLightSources();
+            std::cout << ">> Clustered Lights: " << Renderer->ClusteredLightNum << "\n";
+         }
+         break;
+      case GLFW_KEY_O:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+            Renderer->setCascadeAtlas( !Renderer->UseCascadeAtlas );
+         }
+         break;
+      case GLFW_KEY_Z:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+            Renderer->UseSampleDistribution = !Renderer->UseSampleDistribution;
+            std::cout << ">> Sample Distribution Splits " << (Renderer->UseSampleDistribution ? "On!\n" : "Off!\n");
+         }
+         break;
+      case GLFW_KEY_T:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) {
+            Renderer->UseTextureGather = !Renderer->UseTextureGather;
+            std::cout << ">> SAT Lookup: " << (Renderer->UseTextureGather ? "Gather\n" : "Fetch\n");
+         }
+         break;
+      case GLFW_KEY_I:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) {
+            Renderer->UseIntegerSAT = !Renderer->UseIntegerSAT;
+            std::cout << ">> Summed Area Table: " << (Renderer->UseIntegerSAT ? "Fixed-Point RG32UI\n" : "RG32F\n");
+         }
+         break;
+      case GLFW_KEY_F:
+         if (!Renderer->Pause) {
+            if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::EVSM) {
+               Renderer->UseEVSMPositiveOnly = !Renderer->UseEVSMPositiveOnly;
+            }
+            else {
+               Renderer->MomentsPrecision = static_cast<MOMENTS_PRECISION>(
+                  (static_cast<int>(Renderer->MomentsPrecision) + 1) % 3
+               );
+            }
+            std::cout << ">> Moments Precision: " << getFormatString( Renderer->getMomentsFormat() ) << "\n";
+         }
+         break;
+      case GLFW_KEY_COMMA:
+         if (!Renderer->Pause) {
+            Renderer->BlurRadius = std::max( Renderer->BlurRadius - 1, 0 );
+            std::cout << ">> Moments Blur Radius: " << Renderer->BlurRadius << "\n";
+         }
+         break;
+      case GLFW_KEY_PERIOD:
+         if (!Renderer->Pause) {
+            Renderer->BlurRadius = std::min( Renderer->BlurRadius + 1, MaxBlurRadius );
+            std::cout << ">> Moments Blur Radius: " << Renderer->BlurRadius << "\n";
+         }
+         break;
+      case GLFW_KEY_MINUS:
+         if (!Renderer->Pause) Renderer->setShadowMapSize( Renderer->ShadowMapSize / 2 );
+         break;
+      case GLFW_KEY_EQUAL:
+         if (!Renderer->Pause) Renderer->setShadowMapSize( Renderer->ShadowMapSize * 2 );
+         break;
+      case GLFW_KEY_B:
+         if (!Renderer->Pause) Renderer->setShadowQualityGovernor( !Renderer->UseShadowQualityGovernor );
+         break;
+      case GLFW_KEY_N:
+         Renderer->setFrameTimeBudget( Renderer->FrameTimeBudget - 1.0 );
+         break;
+      case GLFW_KEY_M:
+         Renderer->setFrameTimeBudget( Renderer->FrameTimeBudget + 1.0 );
+         break;
+      case GLFW_KEY_R:
+         Renderer->UseDeferredShading = !Renderer->UseDeferredShading;
+         std::cout << ">> " << (Renderer->UseDeferredShading ? "Deferred" : "Forward") << " Shading Selected\n";
+         break;
+      case GLFW_KEY_K:
+         Renderer->UseShadowCache = !Renderer->UseShadowCache;
+         Renderer->ShadowCacheQueryNum = Renderer->ShadowCacheHitNum = 0;
+         Renderer->CachedShadowMapState.IsValid = false;
+         std::cout << ">> Shadow Map Cache " << (Renderer->UseShadowCache ? "On!\n" : "Off!\n");
+         break;
+      case GLFW_KEY_U:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+            const int interval = Renderer->CascadeUpdateInterval;
+            Renderer->CascadeUpdateInterval = interval >= 8 ? 1 : interval * 2;
+            std::cout << ">> Far Cascades Updated Every " << Renderer->CascadeUpdateInterval << " Frames\n";
+         }
+         break;
       case GLFW_KEY_C:
          Renderer->writeFrame();
          std::cout << ">> Framebuffer Captured\n";
@@ -223,6 +786,22 @@ void RendererGL::keyboard(GLFWwindow* window, int key, int scancode, int action,
             std::cout << ">> Split Depth Maps Captured\n";
          }
          break;
+      case GLFW_KEY_LEFT_BRACKET:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+            Renderer->setSplitNum( Renderer->SplitNum - 1 );
+         }
+         break;
+      case GLFW_KEY_RIGHT_BRACKET:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+            Renderer->setSplitNum( Renderer->SplitNum + 1 );
+         }
+         break;
+      case GLFW_KEY_G:
+         if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+            Renderer->UseLayeredCascades = !Renderer->UseLayeredCascades;
+            std::cout << ">> Single-Pass Layered Cascades " << (Renderer->UseLayeredCascades ? "On!\n" : "Off!\n");
+         }
+         break;
       case GLFW_KEY_S:
          if (Renderer->AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) {
             Renderer->writeSATTexture();
@@ -310,9 +889,56 @@ void RendererGL::setLights() const
    const glm::vec4 diffuse_color(0.9f, 0.9f, 0.9f, 1.0f);
    const glm::vec4 specular_color(0.9f, 0.9f, 0.9f, 1.0f);
    Lights->addLight( light_position, ambient_color, diffuse_color, specular_color );
+
+   // the point light between the statues is shaded only when OVSM or the shadowed lights are selected.
+   const glm::vec4 point_light_color(0.9f, 0.8f, 0.6f, 1.0f);
+   Lights->addLight(
+      glm::vec4(50.0f, 260.0f, 50.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), point_light_color, point_light_color,
+      glm::vec3(0.0f, -1.0f, 0.0f), 180.0f, 0.0f, 700.0f
+   );
+
+   // the spotlights around the statues are shaded only when the shadowed lights are selected.
+   constexpr int spotlight_num = 12;
+   constexpr float spotlight_cutoff_angle = 30.0f;
+   constexpr float spotlight_feather = 0.3f;
+   constexpr float spotlight_falloff_radius = 600.0f;
+   const glm::vec4 black(0.0f, 0.0f, 0.0f, 1.0f);
+   for (int i = 0; i < spotlight_num; ++i) {
+      const float angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(spotlight_num);
+      const glm::vec3 position(420.0f * std::cos( angle ), 450.0f, 420.0f * std::sin( angle ));
+      const glm::vec3 target(100.0f * std::cos( angle ), 0.0f, 100.0f * std::sin( angle ));
+      const glm::vec3 hue = 0.5f + 0.5f * glm::cos( angle + glm::vec3(0.0f, 2.0f, 4.0f) );
+      const glm::vec4 color(0.35f * hue, 1.0f);
+      Lights->addLight(
+         glm::vec4(position, 1.0f), black, color, color, glm::normalize( target - position ),
+         spotlight_cutoff_angle, spotlight_feather, spotlight_falloff_radius
+      );
+   }
+}
+
+void RendererGL::setClusteredLightSources()
+{
+   // the small point lights are scattered inside the box with a fixed seed, so every count shows the same layout.
+   ClusteredLights = std::make_unique<LightGL>();
+   std::mt19937 generator( 11 );
+   std::uniform_real_distribution<float> horizontal( -BoxHalfSide, BoxHalfSide );
+   std::uniform_real_distribution<float> vertical( 10.0f, 300.0f );
+   std::uniform_real_distribution<float> hue_angle( 0.0f, glm::two_pi<float>() );
+   const glm::vec4 black(0.0f, 0.0f, 0.0f, 1.0f);
+   for (int i = 0; i < ClusteredLightNum; ++i) {
+      const float x = horizontal( generator );
+      const float y = vertical( generator );
+      const float z = horizontal( generator );
+      const glm::vec3 hue = 0.5f + 0.5f * glm::cos( hue_angle( generator ) + glm::vec3(0.0f, 2.0f, 4.0f) );
+      const glm::vec4 color(0.6f * hue, 1.0f);
+      ClusteredLights->addLight(
+         glm::vec4(x, y, z, 1.0f), black, color, color, glm::vec3(0.0f, 0.0f, -1.0f), 180.0f, 0.0f,
+         ClusteredLightFallOffRadius
+      );
+   }
 }
 
-void RendererGL::setObject() const
+void RendererGL::setObject()
 {
    const std::string sample_directory_path = std::string(CMAKE_SOURCE_DIR) + "/samples";
    Object->setObject(
@@ -320,6 +946,17 @@ void RendererGL::setObject() const
       std::string(sample_directory_path + "/Buddha/buddha.obj")
    );
    Object->setDiffuseReflectionColor( { 1.0f, 1.0f, 1.0f, 1.0f } );
+
+   const glm::mat4 to_object =
+      glm::translate( glm::mat4(1.0f), glm::vec3(0.0f, 80.0f, 0.0f) ) *
+      glm::rotate( glm::mat4(1.0f), glm::radians( -90.0f ), glm::vec3(1.0f, 0.0f, 0.0f) ) *
+      glm::scale( glm::mat4(1.0f), glm::vec3(0.3f) );
+   ObjectTransforms = {
+      glm::translate( glm::mat4(1.0f), glm::vec3(350.0f, 0.0f, 0.0f) ) * to_object,
+      glm::translate( glm::mat4(1.0f), glm::vec3(-250.0f, 0.0f, 0.0f) ) * to_object,
+      glm::translate( glm::mat4(1.0f), glm::vec3(50.0f, 0.0f, -100.0f) ) * to_object,
+      glm::translate( glm::mat4(1.0f), glm::vec3(50.0f, 0.0f, 200.0f) ) * to_object
+   };
 }
 
 void RendererGL::setWallObject() const
@@ -346,8 +983,93 @@ void RendererGL::setWallObject() const
    WallObject->setDiffuseReflectionColor( { 0.39f, 0.35f, 0.52f, 1.0f } );
 }
 
+GLenum RendererGL::getMomentsFormat() const
+{
+   // the summed area table accumulates the moments in place, so it always needs the full precision.
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) return GL_RG32F;
+
+   // the cascades with the summed area tables accumulate in place as well.
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM && UseCascadeSAT) return GL_RG32F;
+
+   // the warped moments are bounded by the exponents, so the half floats are enough for them.
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::EVSM) return UseEVSMPositiveOnly ? GL_RG16F : GL_RGBA16F;
+
+   switch (MomentsPrecision) {
+      case MOMENTS_PRECISION::RG32F: return GL_RG32F;
+      case MOMENTS_PRECISION::RG16F: return GL_RG16F;
+      case MOMENTS_PRECISION::RG16: return GL_RG16;
+   }
+   return GL_RG32F;
+}
+
+float RendererGL::getMinVariance() const
+{
+   // the minimum variance should hide the quantization error of E[x^2] - E[x]^2 for each storage format.
+   switch (MomentsFormat) {
+      case GL_RG16F:
+      case GL_RGBA16F: return 2e-4f;
+      case GL_RG16: return 2e-5f;
+      default: return 1e-6f;
+   }
+}
+
+size_t RendererGL::getShadowMapMemorySize(GLenum moments_format) const
+{
+   const auto texel_num = static_cast<size_t>(ShadowMapSize) * static_cast<size_t>(ShadowMapSize);
+   const auto depth_bytes = static_cast<size_t>(getBytesPerTexel( GL_DEPTH_COMPONENT32F ));
+   const auto moments_bytes = static_cast<size_t>(getBytesPerTexel( moments_format ));
+
+   const size_t cascade_texel_num = getCascadeTexelNum();
+   size_t size = texel_num * depth_bytes + cascade_texel_num * depth_bytes;
+
+   // the mip chain of the moments map adds about a third of the base level.
+   size += texel_num * moments_bytes * 4 / 3;
+   size += cascade_texel_num * moments_bytes;
+   size += texel_num * moments_bytes;
+   size += texel_num * static_cast<size_t>(getBytesPerTexel( GL_RG32UI ));
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::OVSM) size += texel_num * 6 * (depth_bytes + moments_bytes * 4 / 3);
+   return size;
+}
+
+size_t RendererGL::getCascadeTexelNum() const
+{
+   if (UseCascadeAtlas) return static_cast<size_t>(CascadeAtlasSize.x) * static_cast<size_t>(CascadeAtlasSize.y);
+   return static_cast<size_t>(ShadowMapSize) * static_cast<size_t>(ShadowMapSize) * static_cast<size_t>(SplitNum);
+}
+
+size_t RendererGL::getAlgorithmMemorySize(ALGORITHM_TO_COMPARE algorithm, GLenum moments_format) const
+{
+   const auto texel_num = static_cast<size_t>(ShadowMapSize) * static_cast<size_t>(ShadowMapSize);
+   const auto depth_bytes = static_cast<size_t>(getBytesPerTexel( GL_DEPTH_COMPONENT32F ));
+   const auto moments_bytes = static_cast<size_t>(getBytesPerTexel( moments_format ));
+   const auto integer_sat_bytes = static_cast<size_t>(getBytesPerTexel( GL_RG32UI ));
+
+   // only the textures that the algorithm actually reads or writes are counted.
+   switch (algorithm) {
+      case ALGORITHM_TO_COMPARE::PCF:
+         return texel_num * depth_bytes;
+      case ALGORITHM_TO_COMPARE::VSM:
+      case ALGORITHM_TO_COMPARE::EVSM:
+         return texel_num * (depth_bytes + moments_bytes * 4 / 3 + moments_bytes);
+      case ALGORITHM_TO_COMPARE::PSVSM:
+         return getCascadeTexelNum() * (depth_bytes + moments_bytes);
+      case ALGORITHM_TO_COMPARE::SATVSM:
+         // the float table is built in place in the moments map, but the fixed-point one needs its own texture
+         // besides the mip chain of the moments map for the mean.
+         if (UseIntegerSAT) return texel_num * (depth_bytes + moments_bytes * 4 / 3 + integer_sat_bytes);
+         return texel_num * (depth_bytes + moments_bytes);
+      case ALGORITHM_TO_COMPARE::OVSM:
+         // the six faces are blurred one by one through the same blur texture.
+         return texel_num * (6 * (depth_bytes + moments_bytes * 4 / 3) + moments_bytes);
+   }
+   return 0;
+}
+
 void RendererGL::setLightViewFrameBuffers()
 {
+   MomentsFormat = getMomentsFormat();
+   CachedShadowMapState.IsValid = false;
+
    glCreateTextures( GL_TEXTURE_2D, 1, &DepthTextureID );
    glTextureStorage2D( DepthTextureID, 1, GL_DEPTH_COMPONENT32F, ShadowMapSize, ShadowMapSize );
    glTextureParameteri( DepthTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
@@ -365,12 +1087,28 @@ void RendererGL::setLightViewFrameBuffers()
    }
 
    glCreateTextures( GL_TEXTURE_2D, 1, &MomentsTextureID );
-   glTextureStorage2D( MomentsTextureID, 1, GL_RG32F, ShadowMapSize, ShadowMapSize );
+   glTextureStorage2D( MomentsTextureID, getMipLevelNum( ShadowMapSize ), MomentsFormat, ShadowMapSize, ShadowMapSize );
    glTextureParameteri( MomentsTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
    glTextureParameteri( MomentsTextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
    glTextureParameteri( MomentsTextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
    glTextureParameteri( MomentsTextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
 
+   GLfloat max_anisotropy = 1.0f;
+   glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY, &max_anisotropy );
+   glTextureParameterf( MomentsTextureID, GL_TEXTURE_MAX_ANISOTROPY, std::min( max_anisotropy, 16.0f ) );
+
+   glCreateTextures( GL_TEXTURE_2D, 1, &BlurTextureID );
+   glTextureStorage2D( BlurTextureID, 1, MomentsFormat, ShadowMapSize, ShadowMapSize );
+   glTextureParameteri( BlurTextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTextureParameteri( BlurTextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+   glCreateTextures( GL_TEXTURE_2D, 1, &IntegerSATTextureID );
+   glTextureStorage2D( IntegerSATTextureID, 1, GL_RG32UI, ShadowMapSize, ShadowMapSize );
+   glTextureParameteri( IntegerSATTextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTextureParameteri( IntegerSATTextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glTextureParameteri( IntegerSATTextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+   glTextureParameteri( IntegerSATTextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+
    glCreateFramebuffers( 1, &MomentsFBO );
    glNamedFramebufferTexture( MomentsFBO, GL_COLOR_ATTACHMENT0, MomentsTextureID, 0 );
    glNamedFramebufferTexture( MomentsFBO, GL_DEPTH_ATTACHMENT, DepthTextureID, 0 );
@@ -379,8 +1117,17 @@ void RendererGL::setLightViewFrameBuffers()
       std::cerr << "MomentsFBO Setup Error\n";
    }
 
+   // the moments cube takes as much as six shadow maps, so it exists only while OVSM is selected.
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::OVSM) setMomentsCubeFrameBuffer();
+
+   // the cascades live either in the layers of an array or in the tiles of an atlas, never in both.
+   if (UseCascadeAtlas) {
+      setCascadeAtlasFrameBuffer();
+      return;
+   }
+
    glCreateTextures( GL_TEXTURE_2D_ARRAY, 1, &MomentsTextureArrayID );
-   glTextureStorage3D( MomentsTextureArrayID, 1, GL_RG32F, ShadowMapSize, ShadowMapSize, SplitNum );
+   glTextureStorage3D( MomentsTextureArrayID, 1, MomentsFormat, ShadowMapSize, ShadowMapSize, SplitNum );
    glTextureParameteri( MomentsTextureArrayID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
    glTextureParameteri( MomentsTextureArrayID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
    glTextureParameteri( MomentsTextureArrayID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
@@ -396,60 +1143,494 @@ void RendererGL::setLightViewFrameBuffers()
       std::cerr << "MomentsLayerFBO Setup Error\n";
    }
 
-   glCreateTextures( GL_TEXTURE_2D, 1, &SATTextureID );
-   glTextureStorage2D( SATTextureID, 1, GL_RG32F, ShadowMapSize, ShadowMapSize );
-   glTextureParameteri( SATTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
-   glTextureParameteri( SATTextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTextureParameteri( SATTextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
-   glTextureParameteri( SATTextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+   // all the splits are rendered at once through gl_Layer, so the depth buffer also needs one layer per split.
+   glCreateTextures( GL_TEXTURE_2D_ARRAY, 1, &DepthTextureArrayID );
+   glTextureStorage3D( DepthTextureArrayID, 1, GL_DEPTH_COMPONENT32F, ShadowMapSize, ShadowMapSize, SplitNum );
+
+   glCreateFramebuffers( 1, &MomentsLayeredFBO );
+   glNamedFramebufferTexture( MomentsLayeredFBO, GL_COLOR_ATTACHMENT0, MomentsTextureArrayID, 0 );
+   glNamedFramebufferTexture( MomentsLayeredFBO, GL_DEPTH_ATTACHMENT, DepthTextureArrayID, 0 );
+
+   if (glCheckNamedFramebufferStatus( MomentsLayeredFBO, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "MomentsLayeredFBO Setup Error\n";
+   }
 }
 
-void RendererGL::drawObject(ShaderGL* shader, CameraGL* camera) const
+void RendererGL::setCascadeAtlasFrameBuffer()
 {
-   glBindVertexArray( Object->getVAO() );
-   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, Object->getIBO() );
-   Object->transferUniformsToShader( shader );
+   // the nearest split keeps the full resolution, and the farther ones are stacked in a column next to it
+   // with the resolution halved each time, so the atlas takes about half the memory of the array.
+   CascadeAtlasTiles.clear();
+   CascadeAtlasSize = glm::ivec2(ShadowMapSize);
+   int column_height = 0;
+   for (int s = 0; s < SplitNum; ++s) {
+      const int size = std::max( ShadowMapSize >> s, MinCascadeTileSize );
+      if (s == 0) {
+         CascadeAtlasTiles.emplace_back( 0, 0, size, size );
+         continue;
+      }
+      CascadeAtlasTiles.emplace_back( ShadowMapSize, column_height, size, size );
+      column_height += size;
+      CascadeAtlasSize = glm::max( CascadeAtlasSize, glm::ivec2(ShadowMapSize + size, column_height) );
+   }
 
-   const glm::mat4 to_object =
-      glm::translate( glm::mat4(1.0f), glm::vec3(0.0f, 80.0f, 0.0f) ) *
-      glm::rotate( glm::mat4(1.0f), glm::radians( -90.0f ), glm::vec3(1.0f, 0.0f, 0.0f) ) *
-      glm::scale( glm::mat4(1.0f), glm::vec3(0.3f) );
-   glm::mat4 to_world = glm::translate( glm::mat4(1.0f), glm::vec3(350.0f, 0.0f, 0.0f) ) * to_object;
-   shader->transferBasicTransformationUniforms( to_world, camera );
-   glDrawElements( Object->getDrawMode(), Object->getIndexNum(), GL_UNSIGNED_INT, nullptr );
+   glCreateTextures( GL_TEXTURE_2D, 1, &MomentsAtlasTextureID );
+   glTextureStorage2D( MomentsAtlasTextureID, 1, MomentsFormat, CascadeAtlasSize.x, CascadeAtlasSize.y );
+   glTextureParameteri( MomentsAtlasTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTextureParameteri( MomentsAtlasTextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTextureParameteri( MomentsAtlasTextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTextureParameteri( MomentsAtlasTextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-   to_world = glm::translate( glm::mat4(1.0f), glm::vec3(-250.0f, 0.0f, 0.0f) ) * to_object;
-   shader->transferBasicTransformationUniforms( to_world, camera );
-   glDrawElements( Object->getDrawMode(), Object->getIndexNum(), GL_UNSIGNED_INT, nullptr );
+   glCreateTextures( GL_TEXTURE_2D, 1, &DepthAtlasTextureID );
+   glTextureStorage2D( DepthAtlasTextureID, 1, GL_DEPTH_COMPONENT32F, CascadeAtlasSize.x, CascadeAtlasSize.y );
 
-   to_world = glm::translate( glm::mat4(1.0f), glm::vec3(50.0f, 0.0f, -100.0f) ) * to_object;
-   shader->transferBasicTransformationUniforms( to_world, camera );
-   glDrawElements( Object->getDrawMode(), Object->getIndexNum(), GL_UNSIGNED_INT, nullptr );
+   glCreateFramebuffers( 1, &MomentsAtlasFBO );
+   glNamedFramebufferTexture( MomentsAtlasFBO, GL_COLOR_ATTACHMENT0, MomentsAtlasTextureID, 0 );
+   glNamedFramebufferTexture( MomentsAtlasFBO, GL_DEPTH_ATTACHMENT, DepthAtlasTextureID, 0 );
 
-   to_world = glm::translate( glm::mat4(1.0f), glm::vec3(50.0f, 0.0f, 200.0f) ) * to_object;
-   shader->transferBasicTransformationUniforms( to_world, camera );
-   glDrawElements( Object->getDrawMode(), Object->getIndexNum(), GL_UNSIGNED_INT, nullptr );
+   if (glCheckNamedFramebufferStatus( MomentsAtlasFBO, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "MomentsAtlasFBO Setup Error\n";
+   }
 }
 
-void RendererGL::drawBoxObject(ShaderGL* shader, const CameraGL* camera) const
+void RendererGL::deleteLightViewFrameBuffers()
 {
-   shader->transferBasicTransformationUniforms( glm::mat4(1.0f), camera );
-   WallObject->transferUniformsToShader( shader );
-   glBindVertexArray( WallObject->getVAO() );
-   glDrawArrays( WallObject->getDrawMode(), 0, WallObject->getVertexNum() );
+   if (DepthTextureID != 0) glDeleteTextures( 1, &DepthTextureID );
+   if (MomentsTextureID != 0) glDeleteTextures( 1, &MomentsTextureID );
+   if (MomentsTextureArrayID != 0) glDeleteTextures( 1, &MomentsTextureArrayID );
+   if (DepthTextureArrayID != 0) glDeleteTextures( 1, &DepthTextureArrayID );
+   if (BlurTextureID != 0) glDeleteTextures( 1, &BlurTextureID );
+   if (IntegerSATTextureID != 0) glDeleteTextures( 1, &IntegerSATTextureID );
+   if (MomentsAtlasTextureID != 0) glDeleteTextures( 1, &MomentsAtlasTextureID );
+   if (DepthAtlasTextureID != 0) glDeleteTextures( 1, &DepthAtlasTextureID );
+   if (DepthFBO != 0) glDeleteFramebuffers( 1, &DepthFBO );
+   if (MomentsFBO != 0) glDeleteFramebuffers( 1, &MomentsFBO );
+   if (MomentsLayerFBO != 0) glDeleteFramebuffers( 1, &MomentsLayerFBO );
+   if (MomentsLayeredFBO != 0) glDeleteFramebuffers( 1, &MomentsLayeredFBO );
+   if (MomentsAtlasFBO != 0) glDeleteFramebuffers( 1, &MomentsAtlasFBO );
+   DepthTextureID = MomentsTextureID = MomentsTextureArrayID = DepthTextureArrayID = BlurTextureID = 0;
+   IntegerSATTextureID = MomentsAtlasTextureID = DepthAtlasTextureID = 0;
+   DepthFBO = MomentsFBO = MomentsLayerFBO = MomentsLayeredFBO = MomentsAtlasFBO = 0;
+   deleteMomentsCubeFrameBuffer();
 }
 
-void RendererGL::drawDepthMapFromLightView() const
+void RendererGL::setMomentsCubeFrameBuffer()
 {
-   glViewport( 0, 0, ShadowMapSize, ShadowMapSize );
-   glBindFramebuffer( GL_FRAMEBUFFER, DepthFBO );
+   // the faces of the point light are rendered at once through gl_Layer, and each of them is also viewed as
+   // a 2D texture, so the blur of the moments map filters them without another shader.
+   glCreateTextures( GL_TEXTURE_CUBE_MAP, 1, &MomentsCubeTextureID );
+   glTextureStorage2D(
+      MomentsCubeTextureID, getMipLevelNum( ShadowMapSize ), MomentsFormat, ShadowMapSize, ShadowMapSize
+   );
+   glTextureParameteri( MomentsCubeTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+   glTextureParameteri( MomentsCubeTextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTextureParameteri( MomentsCubeTextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTextureParameteri( MomentsCubeTextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glTextureParameteri( MomentsCubeTextureID, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+
+   glGenTextures( 6, MomentsCubeFaceViewIDs.data() );
+   for (int face = 0; face < 6; ++face) {
+      glTextureView( MomentsCubeFaceViewIDs[face], GL_TEXTURE_2D, MomentsCubeTextureID, MomentsFormat, 0, 1, face, 1 );
+   }
 
-   constexpr GLfloat one = 1.0f;
-   glClearNamedFramebufferfv( DepthFBO, GL_DEPTH, 0, &one );
-   glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+   glCreateTextures( GL_TEXTURE_CUBE_MAP, 1, &DepthCubeTextureID );
+   glTextureStorage2D( DepthCubeTextureID, 1, GL_DEPTH_COMPONENT32F, ShadowMapSize, ShadowMapSize );
 
-   glUseProgram( LightViewDepthShader->getShaderProgram() );
-   drawObject( LightViewDepthShader.get(), LightCamera.get() );
+   glCreateFramebuffers( 1, &MomentsCubeFBO );
+   glNamedFramebufferTexture( MomentsCubeFBO, GL_COLOR_ATTACHMENT0, MomentsCubeTextureID, 0 );
+   glNamedFramebufferTexture( MomentsCubeFBO, GL_DEPTH_ATTACHMENT, DepthCubeTextureID, 0 );
+
+   if (glCheckNamedFramebufferStatus( MomentsCubeFBO, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "MomentsCubeFBO Setup Error\n";
+   }
+}
+
+void RendererGL::deleteMomentsCubeFrameBuffer()
+{
+   if (MomentsCubeFaceViewIDs[0] != 0) glDeleteTextures( 6, MomentsCubeFaceViewIDs.data() );
+   if (MomentsCubeTextureID != 0) glDeleteTextures( 1, &MomentsCubeTextureID );
+   if (DepthCubeTextureID != 0) glDeleteTextures( 1, &DepthCubeTextureID );
+   if (MomentsCubeFBO != 0) glDeleteFramebuffers( 1, &MomentsCubeFBO );
+   MomentsCubeTextureID = DepthCubeTextureID = MomentsCubeFBO = 0;
+   MomentsCubeFaceViewIDs.fill( 0 );
+}
+
+void RendererGL::setShadowMapSize(int size)
+{
+   GLint max_texture_size = MaxShadowMapSize;
+   glGetIntegerv( GL_MAX_TEXTURE_SIZE, &max_texture_size );
+   size = std::clamp( size, MinShadowMapSize, std::min( MaxShadowMapSize, static_cast<int>(max_texture_size) ) );
+   if (size == ShadowMapSize) return;
+
+   // the pending errors are cleared so that only the allocation is checked, but a lost context keeps reporting one.
+   for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError()) {
+      if (error == GL_CONTEXT_LOST) return;
+   }
+
+   // the previous resources are released first, so both sets of them never need to fit in the memory together.
+   const int previous_size = ShadowMapSize;
+   deleteLightViewFrameBuffers();
+   ShadowMapSize = size;
+   setLightViewFrameBuffers();
+
+   if (glGetError() == GL_OUT_OF_MEMORY) {
+      std::cerr << "Not Enough Memory for " << size << "x" << size << " Shadow Maps\n";
+      deleteLightViewFrameBuffers();
+      ShadowMapSize = previous_size;
+      setLightViewFrameBuffers();
+   }
+   RenderedLightViewProjectionMatrices.clear();
+   std::cout << ">> Shadow Map Size: " << ShadowMapSize << "x" << ShadowMapSize << "\n";
+}
+
+void RendererGL::setSplitNum(int split_num)
+{
+   split_num = std::clamp( split_num, 1, MaxSplitNum );
+   if (split_num == SplitNum) return;
+
+   // the moments array and the layered framebuffers have one layer per split.
+   deleteLightViewFrameBuffers();
+   SplitNum = split_num;
+   setLightViewFrameBuffers();
+   setCascadeShaders();
+   RenderedLightViewProjectionMatrices.clear();
+   std::cout << ">> Split Number: " << SplitNum << "\n";
+}
+
+void RendererGL::setCascadeAtlas(bool use_atlas)
+{
+   if (use_atlas == UseCascadeAtlas) return;
+
+   // the summed area tables are built over whole layers, so they are not kept for the tiles of the atlas.
+   deleteLightViewFrameBuffers();
+   UseCascadeAtlas = use_atlas;
+   if (UseCascadeAtlas) UseCascadeSAT = false;
+   setLightViewFrameBuffers();
+   setCascadeShaders();
+   RenderedLightViewProjectionMatrices.clear();
+   std::cout << ">> Cascade " << (UseCascadeAtlas ? "Atlas" : "Array") << " Selected\n";
+}
+
+void RendererGL::setAlgorithmToCompare(ALGORITHM_TO_COMPARE algorithm)
+{
+   AlgorithmToCompare = algorithm;
+   if (AlgorithmToCompare != ALGORITHM_TO_COMPARE::OVSM) deleteMomentsCubeFrameBuffer();
+   else if (MomentsCubeFBO == 0) setMomentsCubeFrameBuffer();
+}
+
+void RendererGL::setShadowedLights(bool use_shadowed_lights)
+{
+   if (use_shadowed_lights == UseShadowedLights) return;
+
+   // the atlas takes its whole budget at once, so it exists only while the shadowed lights are selected.
+   if (use_shadowed_lights) setShadowAtlas();
+   else deleteShadowAtlas();
+   UseShadowedLights = use_shadowed_lights;
+   if (UseClusteredLights) setClusteredLightsShaders();
+   std::cout << ">> Shadowed Lights " << (UseShadowedLights ? "On!\n" : "Off!\n");
+}
+
+void RendererGL::setClusteredLights(bool use_clustered_lights)
+{
+   if (use_clustered_lights == UseClusteredLights) return;
+
+   UseClusteredLights = use_clustered_lights;
+   if (UseClusteredLights) {
+      setClusteredLightsShaders();
+      setClusteredLightSources();
+   }
+   else ClusteredLights.reset();
+   std::cout << ">> Clustered Lights " << (UseClusteredLights ? "On!\n" : "Off!\n");
+}
+
+void RendererGL::setFrameTimeBudget(double budget_in_milliseconds)
+{
+   FrameTimeBudget = std::max( budget_in_milliseconds, 1.0 );
+   GovernorCooldownFrameNum = OverBudgetFrameNum = UnderBudgetFrameNum = 0;
+   std::cout << ">> Frame Time Budget: " << FrameTimeBudget << " ms\n";
+}
+
+void RendererGL::setShadowQualityGovernor(bool use_governor)
+{
+   if (use_governor == UseShadowQualityGovernor) return;
+
+   UseShadowQualityGovernor = use_governor;
+   GovernorCooldownFrameNum = OverBudgetFrameNum = UnderBudgetFrameNum = 0;
+   if (UseShadowQualityGovernor) {
+      // the governor starts from the finest level that does not need a larger shadow map than the current one,
+      // and applies it at once, so every parameter it steps from belongs to that level.
+      const int last_level_index = static_cast<int>(ShadowQualityLevels.size()) - 1;
+      int level_index = 0;
+      while (level_index < last_level_index && ShadowQualityLevels[level_index + 1].ShadowMapSize <= ShadowMapSize) {
+         level_index++;
+      }
+      applyShadowQualityLevel( level_index );
+   }
+   std::cout << ">> Shadow Quality Governor " << (UseShadowQualityGovernor ? "On!\n" : "Off!\n");
+}
+
+void RendererGL::setGeometryBuffers()
+{
+   // the geometry buffers keep only what the lighting pass cannot reconstruct. the position comes from the depth,
+   // the normal is encoded onto the octahedron in two signed 16-bit channels, and the material is an 8-bit index.
+   glCreateTextures( GL_TEXTURE_2D, 1, &GBufferDepthTextureID );
+   glTextureStorage2D( GBufferDepthTextureID, 1, GL_DEPTH_COMPONENT32F, FrameWidth, FrameHeight );
+   glTextureParameteri( GBufferDepthTextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTextureParameteri( GBufferDepthTextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+   glCreateTextures( GL_TEXTURE_2D, 1, &GBufferNormalTextureID );
+   glTextureStorage2D( GBufferNormalTextureID, 1, GL_RG16_SNORM, FrameWidth, FrameHeight );
+   glTextureParameteri( GBufferNormalTextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTextureParameteri( GBufferNormalTextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+   glCreateTextures( GL_TEXTURE_2D, 1, &GBufferMaterialTextureID );
+   glTextureStorage2D( GBufferMaterialTextureID, 1, GL_R8UI, FrameWidth, FrameHeight );
+   glTextureParameteri( GBufferMaterialTextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTextureParameteri( GBufferMaterialTextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+   glCreateFramebuffers( 1, &GBufferFBO );
+   glNamedFramebufferTexture( GBufferFBO, GL_COLOR_ATTACHMENT0, GBufferNormalTextureID, 0 );
+   glNamedFramebufferTexture( GBufferFBO, GL_COLOR_ATTACHMENT1, GBufferMaterialTextureID, 0 );
+   glNamedFramebufferTexture( GBufferFBO, GL_DEPTH_ATTACHMENT, GBufferDepthTextureID, 0 );
+   constexpr std::array<GLenum, 2> draw_buffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+   glNamedFramebufferDrawBuffers( GBufferFBO, static_cast<GLsizei>(draw_buffers.size()), draw_buffers.data() );
+
+   if (glCheckNamedFramebufferStatus( GBufferFBO, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "GBufferFBO Setup Error\n";
+   }
+
+   // the forward shading needs only the depth of the visible surfaces, so it renders into the same depth alone.
+   glCreateFramebuffers( 1, &SceneDepthFBO );
+   glNamedFramebufferTexture( SceneDepthFBO, GL_DEPTH_ATTACHMENT, GBufferDepthTextureID, 0 );
+
+   if (glCheckNamedFramebufferStatus( SceneDepthFBO, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "SceneDepthFBO Setup Error\n";
+   }
+
+   glCreateVertexArrays( 1, &FullScreenVAO );
+}
+
+void RendererGL::deleteGeometryBuffers()
+{
+   if (GBufferDepthTextureID != 0) glDeleteTextures( 1, &GBufferDepthTextureID );
+   if (GBufferNormalTextureID != 0) glDeleteTextures( 1, &GBufferNormalTextureID );
+   if (GBufferMaterialTextureID != 0) glDeleteTextures( 1, &GBufferMaterialTextureID );
+   if (GBufferFBO != 0) glDeleteFramebuffers( 1, &GBufferFBO );
+   if (SceneDepthFBO != 0) glDeleteFramebuffers( 1, &SceneDepthFBO );
+   if (FullScreenVAO != 0) glDeleteVertexArrays( 1, &FullScreenVAO );
+   if (MaterialUBO != 0) glDeleteBuffers( 1, &MaterialUBO );
+   GBufferDepthTextureID = GBufferNormalTextureID = GBufferMaterialTextureID = 0;
+   GBufferFBO = SceneDepthFBO = FullScreenVAO = MaterialUBO = 0;
+}
+
+RendererGL::MaterialInfo RendererGL::getMaterialInfo(const ObjectGL* object)
+{
+   MaterialInfo material{};
+   material.EmissionColor = object->getEmissionColor();
+   material.AmbientColor = object->getAmbientReflectionColor();
+   material.DiffuseColor = object->getDiffuseReflectionColor();
+   material.SpecularColor = object->getSpecularReflectionColor();
+   material.SpecularExponent = object->getSpecularReflectionExponent();
+   return material;
+}
+
+void RendererGL::setShadowAtlas()
+{
+   // the atlas is allocated once with a fixed size, however many lights are shadowed.
+   glCreateTextures( GL_TEXTURE_2D, 1, &ShadowAtlasTextureID );
+   glTextureStorage2D( ShadowAtlasTextureID, 1, GL_RG32F, ShadowAtlasSize, ShadowAtlasSize );
+   glTextureParameteri( ShadowAtlasTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTextureParameteri( ShadowAtlasTextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTextureParameteri( ShadowAtlasTextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTextureParameteri( ShadowAtlasTextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+   glCreateTextures( GL_TEXTURE_2D, 1, &ShadowAtlasDepthTextureID );
+   glTextureStorage2D( ShadowAtlasDepthTextureID, 1, GL_DEPTH_COMPONENT32F, ShadowAtlasSize, ShadowAtlasSize );
+
+   glCreateFramebuffers( 1, &ShadowAtlasFBO );
+   glNamedFramebufferTexture( ShadowAtlasFBO, GL_COLOR_ATTACHMENT0, ShadowAtlasTextureID, 0 );
+   glNamedFramebufferTexture( ShadowAtlasFBO, GL_DEPTH_ATTACHMENT, ShadowAtlasDepthTextureID, 0 );
+
+   if (glCheckNamedFramebufferStatus( ShadowAtlasFBO, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "ShadowAtlasFBO Setup Error\n";
+   }
+   LightShadowAtlas = std::make_unique<ShadowAtlas>( ShadowAtlasSize, MinLightTileSize );
+}
+
+void RendererGL::deleteShadowAtlas()
+{
+   if (ShadowAtlasTextureID != 0) glDeleteTextures( 1, &ShadowAtlasTextureID );
+   if (ShadowAtlasDepthTextureID != 0) glDeleteTextures( 1, &ShadowAtlasDepthTextureID );
+   if (ShadowAtlasFBO != 0) glDeleteFramebuffers( 1, &ShadowAtlasFBO );
+   ShadowAtlasTextureID = ShadowAtlasDepthTextureID = ShadowAtlasFBO = 0;
+   LightShadowAtlas.reset();
+}
+
+void RendererGL::setShadowedLightCameras()
+{
+   glm::vec3 min_point, max_point;
+   getSceneBoundingBox( min_point, max_point );
+   const glm::vec3 scene_center = 0.5f * (min_point + max_point);
+   const float scene_radius = 0.5f * glm::length( max_point - min_point );
+
+   ShadowedLightCameras.clear();
+   const int light_num = std::min( Lights->getTotalLightNum(), MaxShadowedLightNum );
+   for (int i = 0; i < light_num; ++i) {
+      const glm::vec4 position = Lights->getLightPosition( i );
+      if (position.w == 0.0f) {
+         auto camera = std::make_unique<CameraGL>(
+            glm::vec3(position), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)
+         );
+         camera->updateOrthographicCamera( LightViewExtent, LightViewExtent );
+         fitLightDepthRangeToScene( camera.get() );
+         ShadowedLightCameras.emplace_back( std::move( camera ) );
+         continue;
+      }
+
+      // a spotlight looks along its direction through its cone, and the other point lights look at the scene
+      // through the cone around it. both reach as far as the farthest corner of the scene.
+      const auto light_position = glm::vec3(position);
+      const float distance = glm::length( scene_center - light_position );
+      glm::vec3 direction;
+      float fov;
+      if (Lights->getSpotlightCutoffAngle( i ) < 180.0f) {
+         direction = glm::normalize( Lights->getSpotlightDirection( i ) );
+         fov = 2.0f * Lights->getSpotlightCutoffAngle( i ) + 10.0f;
+      }
+      else {
+         direction = distance > 0.0f ? (scene_center - light_position) / distance : glm::vec3(0.0f, -1.0f, 0.0f);
+         fov = distance > scene_radius ? 2.0f * glm::degrees( std::asin( scene_radius / distance ) ) : 120.0f;
+      }
+      const glm::vec3 up = std::abs( direction.y ) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+      constexpr float near = 10.0f;
+      const float far = distance + scene_radius;
+      auto camera = std::make_unique<CameraGL>(
+         light_position, light_position + direction, up, std::min( fov, 120.0f ), near, far
+      );
+      camera->updatePerspectiveCamera( 1, 1 );
+      ShadowedLightCameras.emplace_back( std::move( camera ) );
+   }
+}
+
+void RendererGL::setMaterialBuffer()
+{
+   std::array<MaterialInfo, MaxMaterialNum> materials{};
+   materials[ObjectMaterialID] = getMaterialInfo( Object.get() );
+   materials[WallMaterialID] = getMaterialInfo( WallObject.get() );
+
+   glCreateBuffers( 1, &MaterialUBO );
+   glNamedBufferStorage( MaterialUBO, sizeof( materials ), materials.data(), 0 );
+   glBindBufferBase( GL_UNIFORM_BUFFER, MaterialBindingPoint, MaterialUBO );
+}
+
+void RendererGL::getSceneBoundingBox(glm::vec3& min_point, glm::vec3& max_point) const
+{
+   min_point = WallObject->getBoundingBoxMin();
+   max_point = WallObject->getBoundingBoxMax();
+
+   const glm::vec3& object_min = Object->getBoundingBoxMin();
+   const glm::vec3& object_max = Object->getBoundingBoxMax();
+   for (const auto& to_world : ObjectTransforms) {
+      for (int i = 0; i < 8; ++i) {
+         const glm::vec3 corner(
+            (i & 1) ? object_max.x : object_min.x,
+            (i & 2) ? object_max.y : object_min.y,
+            (i & 4) ? object_max.z : object_min.z
+         );
+         const glm::vec3 corner_in_wc = glm::vec3(to_world * glm::vec4(corner, 1.0f));
+         min_point = glm::min( min_point, corner_in_wc );
+         max_point = glm::max( max_point, corner_in_wc );
+      }
+   }
+}
+
+void RendererGL::fitLightDepthRangeToScene(CameraGL* camera) const
+{
+   // the light depth range is fitted to the scene, so the moments use the whole range of the storage format.
+   // it is what keeps the 16-bit formats free from the quantization artifacts.
+   glm::vec3 min_point, max_point;
+   getSceneBoundingBox( min_point, max_point );
+
+   float near = std::numeric_limits<float>::max();
+   float far = std::numeric_limits<float>::lowest();
+   const glm::mat4& light_view = camera->getViewMatrix();
+   for (int i = 0; i < 8; ++i) {
+      const glm::vec3 corner(
+         (i & 1) ? max_point.x : min_point.x,
+         (i & 2) ? max_point.y : min_point.y,
+         (i & 4) ? max_point.z : min_point.z
+      );
+      const float depth = -(light_view * glm::vec4(corner, 1.0f)).z;
+      near = std::min( near, depth );
+      far = std::max( far, depth );
+   }
+
+   constexpr float margin = 1.0f;
+   camera->updateNearFarPlanes( near - margin, far + margin );
+}
+
+RendererGL::ShadowMapState RendererGL::getShadowMapState() const
+{
+   ShadowMapState state;
+   state.IsValid = true;
+   state.Algorithm = AlgorithmToCompare;
+   state.MomentsFormat = MomentsFormat;
+   state.ShadowMapSize = ShadowMapSize;
+   state.ObjectTransforms = ObjectTransforms;
+   state.LightViewProjectionMatrices = { LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix() };
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM || AlgorithmToCompare == ALGORITHM_TO_COMPARE::EVSM ||
+       AlgorithmToCompare == ALGORITHM_TO_COMPARE::OVSM) {
+      state.BlurRadius = BlurRadius;
+   }
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::OVSM) state.LightViewProjectionMatrices = PointLightFaceMatrices;
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM) state.UseShadowedLights = UseShadowedLights;
+
+   // the crops of the splits are not a part of the state because each cascade is scheduled separately.
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+      state.UseLayeredCascades = UseLayeredCascades;
+      state.UseCascadeSAT = UseCascadeSAT;
+   }
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) state.UseIntegerSAT = UseIntegerSAT;
+   return state;
+}
+
+int RendererGL::getSATMaxFilterSize(bool is_integer_table) const
+{
+   const int max_filter_size = SATMaxFilterSize == UnlimitedFilterSize ? ShadowMapSize : SATMaxFilterSize;
+   return is_integer_table ? std::min( max_filter_size, IntegerSATMaxFilterSize ) : max_filter_size;
+}
+
+void RendererGL::drawObject(ShaderGL* shader, CameraGL* camera) const
+{
+   glBindVertexArray( Object->getVAO() );
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, Object->getIBO() );
+   Object->transferUniformsToShader( shader );
+
+   for (const auto& to_world : ObjectTransforms) {
+      shader->transferBasicTransformationUniforms( to_world, camera );
+      glDrawElements( Object->getDrawMode(), Object->getIndexNum(), GL_UNSIGNED_INT, nullptr );
+   }
+}
+
+void RendererGL::drawBoxObject(ShaderGL* shader, const CameraGL* camera) const
+{
+   shader->transferBasicTransformationUniforms( glm::mat4(1.0f), camera );
+   WallObject->transferUniformsToShader( shader );
+   glBindVertexArray( WallObject->getVAO() );
+   glDrawArrays( WallObject->getDrawMode(), 0, WallObject->getVertexNum() );
+}
+
+void RendererGL::drawDepthMapFromLightView() const
+{
+   glViewport( 0, 0, ShadowMapSize, ShadowMapSize );
+   glBindFramebuffer( GL_FRAMEBUFFER, DepthFBO );
+
+   constexpr GLfloat one = 1.0f;
+   glClearNamedFramebufferfv( DepthFBO, GL_DEPTH, 0, &one );
+   glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+
+   glUseProgram( LightViewDepthShader->getShaderProgram() );
+   drawObject( LightViewDepthShader.get(), LightCamera.get() );
    drawBoxObject( LightViewDepthShader.get(), LightCamera.get() );
 
    glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
@@ -471,7 +1652,46 @@ void RendererGL::drawMomentsMapFromLightView() const
    drawBoxObject( LightViewMomentsShader.get(), LightCamera.get() );
 }
 
-void RendererGL::drawMomentsArrayMapFromLightView() const
+void RendererGL::drawMomentsCubeMapFromPointLight() const
+{
+   glViewport( 0, 0, ShadowMapSize, ShadowMapSize );
+   glBindFramebuffer( GL_FRAMEBUFFER, MomentsCubeFBO );
+
+   // clearing the layered framebuffer clears all the faces at once.
+   constexpr GLfloat one = 1.0f;
+   constexpr std::array<GLfloat, 2> clear_moments = { 1.0f, 1.0f };
+   glClearNamedFramebufferfv( MomentsCubeFBO, GL_COLOR, 0, &clear_moments[0] );
+   glClearNamedFramebufferfv( MomentsCubeFBO, GL_DEPTH, 0, &one );
+
+   ShaderGL* shader = LightViewCubeMomentsShader.get();
+   glUseProgram( shader->getShaderProgram() );
+   shader->uniformMat4fv( UNIFORM::LightViewProjectionMatrix, PointLightFaceMatrices );
+   shader->uniform3fv( UNIFORM::LightPosition, glm::vec3(Lights->getLightPosition( PointLightIndex )) );
+   shader->uniform1f( UNIFORM::LightFarPlane, PointLightFarPlane );
+
+   // each statue is routed only to the faces that its bounding box overlaps, and the geometry shader culls
+   // the remaining triangles per face, so the scene is submitted once instead of six times.
+   glBindVertexArray( Object->getVAO() );
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, Object->getIBO() );
+   Object->transferUniformsToShader( shader );
+   for (const auto& to_world : ObjectTransforms) {
+      const int face_mask = getPointLightFaceMask( Object.get(), to_world );
+      if (face_mask == 0) continue;
+
+      shader->uniform1i( UNIFORM::FaceMask, face_mask );
+      shader->transferBasicTransformationUniforms( to_world, LightCamera.get() );
+      glDrawElements( Object->getDrawMode(), Object->getIndexNum(), GL_UNSIGNED_INT, nullptr );
+   }
+
+   // the box is only the floor below the light, so it is routed in the same way and skips the upper face.
+   const int wall_face_mask = getPointLightFaceMask( WallObject.get(), glm::mat4(1.0f) );
+   if (wall_face_mask == 0) return;
+
+   shader->uniform1i( UNIFORM::FaceMask, wall_face_mask );
+   drawBoxObject( shader, LightCamera.get() );
+}
+
+void RendererGL::drawMomentsArrayMapFromLightView(int split_mask) const
 {
    glViewport( 0, 0, ShadowMapSize, ShadowMapSize );
    glBindFramebuffer( GL_FRAMEBUFFER, MomentsLayerFBO );
@@ -480,25 +1700,218 @@ void RendererGL::drawMomentsArrayMapFromLightView() const
    constexpr std::array<GLfloat, 2> clear_moments = { 1.0f, 1.0f };
 
    glUseProgram( LightViewMomentsArrayShader->getShaderProgram() );
-   LightViewMomentsArrayShader->uniformMat4fv( "LightViewProjectionMatrix", LightViewProjectionMatrices );
+   LightViewMomentsArrayShader->uniformMat4fv(
+      UNIFORM::LightViewProjectionMatrix, RenderedLightViewProjectionMatrices
+   );
 
    for (int i = 0; i < SplitNum; ++i) {
+      if ((split_mask & (1 << i)) == 0) continue;
+
       const GLenum draw_buffer = GL_COLOR_ATTACHMENT0 + i;
       glNamedFramebufferDrawBuffers( MomentsLayerFBO, 1, &draw_buffer );
       glClearNamedFramebufferfv( MomentsLayerFBO, GL_COLOR, 0, &clear_moments[0] );
       glClearNamedFramebufferfv( MomentsLayerFBO, GL_DEPTH, 0, &one );
 
-      LightViewMomentsArrayShader->uniform1i( "TextureIndex", i );
-      drawObject( LightViewMomentsArrayShader.get(), LightCamera.get() );
-      drawBoxObject( LightViewMomentsArrayShader.get(), LightCamera.get() );
+      LightViewMomentsArrayShader->uniform1i( UNIFORM::TextureIndex, i );
+      drawObject( LightViewMomentsArrayShader, LightCamera.get() );
+      drawBoxObject( LightViewMomentsArrayShader, LightCamera.get() );
+   }
+}
+
+void RendererGL::drawMomentsArrayMapFromLightViewInSinglePass(int split_mask) const
+{
+   glViewport( 0, 0, ShadowMapSize, ShadowMapSize );
+   glBindFramebuffer( GL_FRAMEBUFFER, MomentsLayeredFBO );
+
+   constexpr GLfloat one = 1.0f;
+   constexpr std::array<GLfloat, 2> clear_moments = { 1.0f, 1.0f };
+   if (split_mask == (1 << SplitNum) - 1) {
+      // clearing the layered framebuffer clears all the layers at once.
+      glClearNamedFramebufferfv( MomentsLayeredFBO, GL_COLOR, 0, &clear_moments[0] );
+      glClearNamedFramebufferfv( MomentsLayeredFBO, GL_DEPTH, 0, &one );
+   }
+   else {
+      for (int i = 0; i < SplitNum; ++i) {
+         if ((split_mask & (1 << i)) == 0) continue;
+         glClearTexSubImage(
+            MomentsTextureArrayID, 0, 0, 0, i, ShadowMapSize, ShadowMapSize, 1, GL_RG, GL_FLOAT, &clear_moments[0]
+         );
+         glClearTexSubImage(
+            DepthTextureArrayID, 0, 0, 0, i, ShadowMapSize, ShadowMapSize, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &one
+         );
+      }
+   }
+
+   // the geometry shader routes each primitive to the splits it overlaps, so the scene is traversed only once.
+   glUseProgram( LightViewMomentsLayeredShader->getShaderProgram() );
+   LightViewMomentsLayeredShader->uniform1i( UNIFORM::SplitMask, split_mask );
+   LightViewMomentsLayeredShader->uniformMat4fv(
+      UNIFORM::LightViewProjectionMatrix, RenderedLightViewProjectionMatrices
+   );
+   drawObject( LightViewMomentsLayeredShader, LightCamera.get() );
+   drawBoxObject( LightViewMomentsLayeredShader, LightCamera.get() );
+}
+
+void RendererGL::drawMomentsAtlasFromLightView(int split_mask) const
+{
+   glBindFramebuffer( GL_FRAMEBUFFER, MomentsAtlasFBO );
+   glEnable( GL_SCISSOR_TEST );
+
+   // the scissor keeps the clears and the draws of a split inside its tile, so the cached tiles stay intact.
+   constexpr GLfloat one = 1.0f;
+   constexpr std::array<GLfloat, 2> clear_moments = { 1.0f, 1.0f };
+   glUseProgram( LightViewMomentsArrayShader->getShaderProgram() );
+   LightViewMomentsArrayShader->uniformMat4fv(
+      UNIFORM::LightViewProjectionMatrix, RenderedLightViewProjectionMatrices
+   );
+   for (int i = 0; i < SplitNum; ++i) {
+      if ((split_mask & (1 << i)) == 0) continue;
+
+      const glm::ivec4& tile = CascadeAtlasTiles[i];
+      glScissor( tile.x, tile.y, tile.z, tile.w );
+      glClearNamedFramebufferfv( MomentsAtlasFBO, GL_COLOR, 0, &clear_moments[0] );
+      glClearNamedFramebufferfv( MomentsAtlasFBO, GL_DEPTH, 0, &one );
+      if (UseLayeredCascades) continue;
+
+      glViewport( tile.x, tile.y, tile.z, tile.w );
+      LightViewMomentsArrayShader->uniform1i( UNIFORM::TextureIndex, i );
+      drawObject( LightViewMomentsArrayShader, LightCamera.get() );
+      drawBoxObject( LightViewMomentsArrayShader, LightCamera.get() );
+   }
+
+   if (UseLayeredCascades) {
+      // each split has its own viewport and scissor, and the geometry shader selects them by gl_ViewportIndex.
+      for (int i = 0; i < SplitNum; ++i) {
+         const glm::ivec4& tile = CascadeAtlasTiles[i];
+         glViewportIndexedf(
+            i, static_cast<float>(tile.x), static_cast<float>(tile.y),
+            static_cast<float>(tile.z), static_cast<float>(tile.w)
+         );
+         glScissorIndexed( i, tile.x, tile.y, tile.z, tile.w );
+      }
+      glUseProgram( LightViewMomentsLayeredShader->getShaderProgram() );
+      LightViewMomentsLayeredShader->uniform1i( UNIFORM::SplitMask, split_mask );
+      LightViewMomentsLayeredShader->uniformMat4fv(
+         UNIFORM::LightViewProjectionMatrix, RenderedLightViewProjectionMatrices
+      );
+      drawObject( LightViewMomentsLayeredShader, LightCamera.get() );
+      drawBoxObject( LightViewMomentsLayeredShader, LightCamera.get() );
+   }
+   glDisable( GL_SCISSOR_TEST );
+}
+
+void RendererGL::drawShadowAtlasFromLights() const
+{
+   if (DirtyShadowTiles.empty()) return;
+
+   glBindFramebuffer( GL_FRAMEBUFFER, ShadowAtlasFBO );
+   glEnable( GL_SCISSOR_TEST );
+
+   // only the tiles whose lights changed or which are new are rendered, one light view pass for each of them.
+   constexpr GLfloat one = 1.0f;
+   constexpr std::array<GLfloat, 2> clear_moments = { 1.0f, 1.0f };
+   ShaderGL* shader = LightViewDistanceMomentsShader.get();
+   glUseProgram( shader->getShaderProgram() );
+   for (const auto& dirty_tile : DirtyShadowTiles) {
+      const glm::ivec4& tile = dirty_tile.second;
+      glViewport( tile.x, tile.y, tile.z, tile.w );
+      glScissor( tile.x, tile.y, tile.z, tile.w );
+      glClearNamedFramebufferfv( ShadowAtlasFBO, GL_COLOR, 0, &clear_moments[0] );
+      glClearNamedFramebufferfv( ShadowAtlasFBO, GL_DEPTH, 0, &one );
+
+      const int light_index = dirty_tile.first;
+      CameraGL* camera = ShadowedLightCameras[light_index].get();
+      shader->uniform3fv( UNIFORM::LightPosition, glm::vec3(Lights->getLightPosition( light_index )) );
+      shader->uniform1f( UNIFORM::LightFarPlane, ShadowedLightFarPlanes[light_index] );
+      drawObject( shader, camera );
+      drawBoxObject( shader, camera );
    }
+   glDisable( GL_SCISSOR_TEST );
+}
+
+void RendererGL::drawExponentialMomentsMapFromLightView() const
+{
+   glViewport( 0, 0, ShadowMapSize, ShadowMapSize );
+   glBindFramebuffer( GL_FRAMEBUFFER, MomentsFBO );
+
+   // the map is cleared to the warped moments of the far plane.
+   const float positive = std::exp( EVSMPositiveExponent );
+   const float negative = -std::exp( -EVSMNegativeExponent );
+   const std::array<GLfloat, 4> clear_moments = { positive, positive * positive, negative, negative * negative };
+   glClearNamedFramebufferfv( MomentsFBO, GL_COLOR, 0, &clear_moments[0] );
+
+   constexpr GLfloat one = 1.0f;
+   glClearNamedFramebufferfv( MomentsFBO, GL_DEPTH, 0, &one );
+
+   glUseProgram( LightViewExponentialMomentsShader->getShaderProgram() );
+   LightViewExponentialMomentsShader->uniform2fv(
+      UNIFORM::Exponents, glm::vec2(EVSMPositiveExponent, EVSMNegativeExponent)
+   );
+   drawObject( LightViewExponentialMomentsShader.get(), LightCamera.get() );
+   drawBoxObject( LightViewExponentialMomentsShader.get(), LightCamera.get() );
+}
+
+void RendererGL::blurMomentsTexture(GLuint moments_texture_id) const
+{
+   // the gaussian kernel covers two standard deviations on each side.
+   const float sigma = static_cast<float>(BlurRadius) * 0.5f;
+   std::array<float, MaxBlurRadius + 1> weights{};
+   float sum = 0.0f;
+   for (int i = 0; i <= BlurRadius; ++i) {
+      weights[i] = std::exp( -static_cast<float>(i * i) / (2.0f * sigma * sigma) );
+      sum += i == 0 ? weights[i] : 2.0f * weights[i];
+   }
+   for (int i = 0; i <= BlurRadius; ++i) weights[i] /= sum;
+
+   glUseProgram( MomentsBlurShader->getShaderProgram() );
+   MomentsBlurShader->uniform1i( UNIFORM::Radius, BlurRadius );
+   MomentsBlurShader->uniform1fv( UNIFORM::Weights, BlurRadius + 1, weights.data() );
+
+   const int g = (ShadowMapSize + BlurGroupSize - 1) / BlurGroupSize;
+   MomentsBlurShader->uniform2iv( UNIFORM::Direction, glm::ivec2(1, 0) );
+   glBindTextureUnit( 0, moments_texture_id );
+   glBindImageTexture( 0, BlurTextureID, 0, GL_FALSE, 0, GL_WRITE_ONLY, MomentsFormat );
+   glDispatchCompute( g, ShadowMapSize, 1 );
+   glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT );
+
+   MomentsBlurShader->uniform2iv( UNIFORM::Direction, glm::ivec2(0, 1) );
+   glBindTextureUnit( 0, BlurTextureID );
+   glBindImageTexture( 0, moments_texture_id, 0, GL_FALSE, 0, GL_WRITE_ONLY, MomentsFormat );
+   glDispatchCompute( g, ShadowMapSize, 1 );
+   glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT );
+}
+
+void RendererGL::filterMomentsMap() const
+{
+   if (BlurRadius > 0) blurMomentsTexture( MomentsTextureID );
+   glGenerateTextureMipmap( MomentsTextureID );
+}
+
+void RendererGL::filterMomentsCubeMap() const
+{
+   // the faces are blurred separately, and the seamless filtering of the cube map smooths over their edges.
+   if (BlurRadius > 0) {
+      for (const auto& face_view_id : MomentsCubeFaceViewIDs) blurMomentsTexture( face_view_id );
+   }
+   glGenerateTextureMipmap( MomentsCubeTextureID );
 }
 
 void RendererGL::splitViewFrustum()
 {
    constexpr float split_weight = 0.5f;
-   const float n = MainCamera->getNearPlane();
-   const float f = MainCamera->getFarPlane();
+   float n = MainCamera->getNearPlane();
+   float f = MainCamera->getFarPlane();
+   if (UseSampleDistribution && SceneDepthBounds->isAvailable()) {
+      // the splits only cover the depths where something is visible, so no texel is spent on the empty range.
+      // the fragments nearer than the first split still fall into it.
+      const glm::vec2& bounds = SceneDepthBounds->getBounds();
+      const float near = glm::clamp( bounds.x * (1.0f - DepthBoundsMargin), n, f );
+      const float far = glm::clamp( bounds.y * (1.0f + DepthBoundsMargin), n, f );
+      if (near < far) {
+         n = near;
+         f = far;
+      }
+   }
    SplitPositions.resize( SplitNum + 1 );
    SplitPositions[0] = n;
    SplitPositions[SplitNum] = f;
@@ -515,175 +1928,527 @@ void RendererGL::calculateLightCropMatrices()
    const glm::mat4& projection_matrix = MainCamera->getProjectionMatrix();
    const float scale_x = 1.0f / projection_matrix[0][0];
    const float scale_y = 1.0f / projection_matrix[1][1];
+   const float squared_half_diagonal_scale = scale_x * scale_x + scale_y * scale_y;
 
    LightViewProjectionMatrices.clear();
-   const glm::mat4 light_view_projection_matrix = LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix();
+   const glm::mat4& light_projection_matrix = LightCamera->getProjectionMatrix();
+   const glm::mat4 light_view_projection_matrix = light_projection_matrix * LightCamera->getViewMatrix();
+   const glm::mat4 to_light = light_view_projection_matrix * glm::inverse( MainCamera->getViewMatrix() );
+   const glm::vec2 to_light_ndc_scale(
+      std::abs( light_projection_matrix[0][0] ),
+      std::abs( light_projection_matrix[1][1] )
+   );
    for (int s = 0; s < SplitNum; ++s) {
       const float near = SplitPositions[s];
       const float far = SplitPositions[s + 1];
-      const float near_plane_half_width = near * scale_x;
-      const float near_plane_half_height = near * scale_y;
-      const float far_plane_half_width = far * scale_x;
-      const float far_plane_half_height = far * scale_y;
-
-      std::array<glm::vec3, 8> frustum{};
-      frustum[0] = glm::vec3(-near_plane_half_width, -near_plane_half_height, -near);
-      frustum[1] = glm::vec3(-near_plane_half_width, near_plane_half_height, -near);
-      frustum[2] = glm::vec3(near_plane_half_width, near_plane_half_height, -near);
-      frustum[3] = glm::vec3(near_plane_half_width, -near_plane_half_height, -near);
-
-      frustum[4] = glm::vec3(-far_plane_half_width, -far_plane_half_height, -far);
-      frustum[5] = glm::vec3(-far_plane_half_width, far_plane_half_height, -far);
-      frustum[6] = glm::vec3(far_plane_half_width, far_plane_half_height, -far);
-      frustum[7] = glm::vec3(far_plane_half_width, -far_plane_half_height, -far);
-
-      std::array<glm::vec4, 8> ndc_points{};
-      const glm::mat4 to_light =
-         LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix() * glm::inverse( MainCamera->getViewMatrix() );
-      for (int i = 0; i < 8; ++i) {
-         ndc_points[i] = to_light * glm::vec4(frustum[i], 1.0f);
-         ndc_points[i].x /= ndc_points[i].w;
-         ndc_points[i].y /= ndc_points[i].w;
-         ndc_points[i].z /= ndc_points[i].w;
-      }
 
-      auto min_point = glm::vec3(std::numeric_limits<float>::max());
-      auto max_point = glm::vec3(std::numeric_limits<float>::lowest());
-      for (int i = 0; i < 8; ++i) {
-         if (ndc_points[i].x < min_point.x) min_point.x = ndc_points[i].x;
-         if (ndc_points[i].y < min_point.y) min_point.y = ndc_points[i].y;
-         if (ndc_points[i].z < min_point.z) min_point.z = ndc_points[i].z;
+      // the bounding sphere of the split does not depend on the camera orientation, so the crop size does not change
+      // while the camera rotates. the center is on the view axis where the near and far corners are equidistant.
+      const float squared_near_half_diagonal = near * near * squared_half_diagonal_scale;
+      const float squared_far_half_diagonal = far * far * squared_half_diagonal_scale;
+      float center_distance =
+         (squared_far_half_diagonal - squared_near_half_diagonal + far * far - near * near) / (2.0f * (far - near));
+      center_distance = glm::clamp( center_distance, near, far );
+      const float radius = std::sqrt( std::max(
+         squared_near_half_diagonal + (center_distance - near) * (center_distance - near),
+         squared_far_half_diagonal + (far - center_distance) * (far - center_distance)
+      ) );
+
+      const glm::vec4 center_in_light = to_light * glm::vec4(0.0f, 0.0f, -center_distance, 1.0f);
+      glm::vec2 center(center_in_light.x / center_in_light.w, center_in_light.y / center_in_light.w);
+      glm::vec2 half_size = glm::min( radius * to_light_ndc_scale, glm::vec2(1.0f) );
+      center = glm::clamp( center, half_size - 1.0f, 1.0f - half_size );
+
+      // the crop moves in whole shadow map texels, so the rasterization of the casters does not shimmer.
+      const int cascade_size = UseCascadeAtlas ? CascadeAtlasTiles[s].z : ShadowMapSize;
+      const glm::vec2 texel_size = 2.0f * half_size / static_cast<float>(cascade_size);
+      center = glm::floor( center / texel_size + 0.5f ) * texel_size;
+
+      // the depth range of the light is already fitted to the scene, so it is kept as it is.
+      glm::mat4 crop(1.0f);
+      crop[0][0] = 1.0f / half_size.x;
+      crop[1][1] = 1.0f / half_size.y;
+      crop[3][0] = -center.x * crop[0][0];
+      crop[3][1] = -center.y * crop[1][1];
+      LightViewProjectionMatrices.emplace_back( crop * light_view_projection_matrix );
+   }
+}
+
+int RendererGL::scheduleCascadeUpdates(bool is_state_changed)
+{
+   // the shadow cache does not take part here, so the cascades follow their snapped crops either way,
+   // and only a change of the rest of the state re-renders all of them.
+   const int all_splits = (1 << SplitNum) - 1;
+   if (is_state_changed || static_cast<int>(RenderedLightViewProjectionMatrices.size()) != SplitNum) {
+      RenderedLightViewProjectionMatrices = LightViewProjectionMatrices;
+      return all_splits;
+   }
+
+   // a cascade is re-rendered only when its snapped crop changes. the nearest one is always kept up to date,
+   // and the farther ones take turns so that each of them is refreshed at most every CascadeUpdateInterval frames.
+   int split_mask = 0;
+   for (int s = 0; s < SplitNum; ++s) {
+      if (RenderedLightViewProjectionMatrices[s] == LightViewProjectionMatrices[s]) continue;
+
+      const auto interval = static_cast<uint>(CascadeUpdateInterval);
+      const bool is_scheduled = s == 0 || (FrameIndex + static_cast<uint>(s)) % interval == 0;
+      if (!is_scheduled) continue;
+
+      RenderedLightViewProjectionMatrices[s] = LightViewProjectionMatrices[s];
+      split_mask |= 1 << s;
+   }
+   return split_mask;
+}
 
-         if (ndc_points[i].x > max_point.x) max_point.x = ndc_points[i].x;
-         if (ndc_points[i].y > max_point.y) max_point.y = ndc_points[i].y;
-         if (ndc_points[i].z > max_point.z) max_point.z = ndc_points[i].z;
+int RendererGL::getShadowedLightTileSize(int light_index, float max_luminance) const
+{
+   // the importance is the brightness of the light over the brightest one, and the coverage is how much of the
+   // screen the sphere of its falloff radius takes. a directional light covers the whole screen.
+   const glm::vec4 position = Lights->getLightPosition( light_index );
+   float coverage = 1.0f;
+   if (position.w != 0.0f) {
+      const float radius = Lights->getFallOffRadius( light_index );
+      const float depth = -(MainCamera->getViewMatrix() * position).z;
+      const float projected_radius = radius * MainCamera->getProjectionMatrix()[1][1] / std::max( depth, radius );
+      coverage = depth < -radius ? 0.0f : std::min( projected_radius, 1.0f );
+   }
+   const glm::vec3 luminance_weights(0.2126f, 0.7152f, 0.0722f);
+   const float luminance = glm::dot( glm::vec3(Lights->getDiffuseColor( light_index )), luminance_weights );
+   const float importance = max_luminance > 0.0f ? luminance / max_luminance : 0.0f;
+
+   // the size is a power of two, so it changes only when the coverage changes a lot and the tile is kept meanwhile.
+   const float texel_num = static_cast<float>(MaxLightTileSize) * coverage * importance;
+   int size = MinLightTileSize;
+   while (size < MaxLightTileSize && static_cast<float>(size * 2) <= texel_num) size *= 2;
+   return size;
+}
+
+void RendererGL::updateShadowedLights()
+{
+   const int light_num = std::min( Lights->getTotalLightNum(), MaxShadowedLightNum );
+   if (static_cast<int>(ShadowedLightCameras.size()) != light_num) setShadowedLightCameras();
+   if (ShadowAtlasObjectTransforms != ObjectTransforms) {
+      LightShadowAtlas->invalidate();
+      ShadowAtlasObjectTransforms = ObjectTransforms;
+   }
+   LightShadowAtlas->beginFrame();
+
+   const glm::vec3 luminance_weights(0.2126f, 0.7152f, 0.0722f);
+   float max_luminance = 0.0f;
+   for (int i = 0; i < light_num; ++i) {
+      max_luminance = std::max( max_luminance, glm::dot( glm::vec3(Lights->getDiffuseColor( i )), luminance_weights ) );
+   }
+
+   // the larger tiles are placed first, so the most important lights get their space before the atlas fills up.
+   std::vector<std::pair<int, int>> requests;
+   for (int i = 0; i < light_num; ++i) {
+      if (Lights->isActivated( i )) requests.emplace_back( getShadowedLightTileSize( i, max_luminance ), i );
+   }
+   std::sort( requests.begin(), requests.end(), std::greater<>() );
+
+   // the lights without any tile are not shadowed.
+   ShadowedLightMatrices.assign( light_num, glm::mat4(1.0f) );
+   ShadowedLightFarPlanes.assign( light_num, 0.0f );
+   ShadowedLightTiles.assign( light_num, glm::vec4(0.0f) );
+   DirtyShadowTiles.clear();
+   for (const auto& request : requests) {
+      const int light_index = request.second;
+      const CameraGL* camera = ShadowedLightCameras[light_index].get();
+      const glm::mat4 view_projection = camera->getProjectionMatrix() * camera->getViewMatrix();
+      glm::ivec4 tile;
+      bool is_dirty = false;
+      if (!LightShadowAtlas->acquire( light_index, request.first, view_projection, tile, is_dirty )) continue;
+
+      if (is_dirty) DirtyShadowTiles.emplace_back( light_index, tile );
+      ShadowedLightMatrices[light_index] = view_projection;
+      if (Lights->getLightPosition( light_index ).w != 0.0f) {
+         ShadowedLightFarPlanes[light_index] = camera->getFarPlane();
       }
-      min_point.z = -1.0f;
+      ShadowedLightTiles[light_index] = glm::vec4(tile) / static_cast<float>(ShadowAtlasSize);
+   }
+}
 
-      constexpr float min_filter_width = 1.0f;
-      const glm::vec2 half_min_filter_width_in_ndc(
-         min_filter_width / static_cast<float>(FrameWidth),
-         min_filter_width / static_cast<float>(FrameHeight)
+void RendererGL::updatePointLightFaces()
+{
+   // the far plane reaches the farthest corner of the scene, and it also normalizes the distances in the moments.
+   const auto light_position = glm::vec3(Lights->getLightPosition( PointLightIndex ));
+   glm::vec3 min_point, max_point;
+   getSceneBoundingBox( min_point, max_point );
+   float far = PointLightNearPlane;
+   for (int i = 0; i < 8; ++i) {
+      const glm::vec3 corner(
+         (i & 1) ? max_point.x : min_point.x,
+         (i & 2) ? max_point.y : min_point.y,
+         (i & 4) ? max_point.z : min_point.z
+      );
+      far = std::max( far, glm::length( corner - light_position ) );
+   }
+   PointLightFarPlane = far + 1.0f;
+
+   // the faces follow the orientations of the cube map targets from +X to -Z.
+   const std::array<std::pair<glm::vec3, glm::vec3>, 6> faces = { {
+      { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) },
+      { glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) },
+      { glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },
+      { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+      { glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f) },
+      { glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f) }
+   } };
+   const glm::mat4 projection =
+      glm::perspective( glm::half_pi<float>(), 1.0f, PointLightNearPlane, PointLightFarPlane );
+   PointLightFaceMatrices.clear();
+   for (const auto& face : faces) {
+      PointLightFaceMatrices.emplace_back(
+         projection * glm::lookAt( light_position, light_position + face.first, face.second )
       );
-      min_point.x -= half_min_filter_width_in_ndc.x;
-      min_point.y -= half_min_filter_width_in_ndc.y;
-      max_point.x += half_min_filter_width_in_ndc.x;
-      max_point.y += half_min_filter_width_in_ndc.y;
+   }
+}
+
+int RendererGL::getPointLightFaceMask(const ObjectGL* object, const glm::mat4& to_world) const
+{
+   // a face skips the object only when all the corners of its bounding box are outside of the same plane.
+   const glm::vec3& object_min = object->getBoundingBoxMin();
+   const glm::vec3& object_max = object->getBoundingBoxMax();
+   int face_mask = 0;
+   for (int face = 0; face < 6; ++face) {
+      std::array<int, 6> outside_num{};
+      for (int i = 0; i < 8; ++i) {
+         const glm::vec3 corner(
+            (i & 1) ? object_max.x : object_min.x,
+            (i & 2) ? object_max.y : object_min.y,
+            (i & 4) ? object_max.z : object_min.z
+         );
+         const glm::vec4 p = PointLightFaceMatrices[face] * to_world * glm::vec4(corner, 1.0f);
+         for (int axis = 0; axis < 3; ++axis) {
+            if (p[axis] < -p.w) outside_num[axis * 2]++;
+            if (p[axis] > p.w) outside_num[axis * 2 + 1]++;
+         }
+      }
+      if (std::find( outside_num.begin(), outside_num.end(), 8 ) == outside_num.end()) face_mask |= 1 << face;
+   }
+   return face_mask;
+}
 
-      min_point = glm::clamp( min_point, -1.0f, 1.0f );
-      max_point = glm::clamp( max_point, -1.0f, 1.0f );
+void RendererGL::applyShadowQualityLevel(int level_index)
+{
+   const ShadowQualityLevel& level = ShadowQualityLevels[level_index];
+   ShadowQualityLevelIndex = level_index;
+   setShadowMapSize( level.ShadowMapSize );
+   setSplitNum( level.SplitNum );
+   PCFMaxFilterSize = level.PCFMaxFilterSize;
+   setPCFShaders();
+   SATMaxFilterSize = level.SATMaxFilterSize;
+   CascadeUpdateInterval = level.CascadeUpdateInterval;
+}
 
-      glm::mat4 crop(1.0f);
-      crop[0][0] = 2.0f / (max_point.x - min_point.x);
-      crop[1][1] = 2.0f / (max_point.y - min_point.y);
-      crop[2][2] = 2.0f / (max_point.z - min_point.z);
-      crop[3][0] = -0.5f * (max_point.x + min_point.x) * crop[0][0];
-      crop[3][1] = -0.5f * (max_point.y + min_point.y) * crop[1][1];
-      crop[3][2] = -0.5f * (max_point.z + min_point.z) * crop[2][2];
-      LightViewProjectionMatrices.emplace_back( crop * light_view_projection_matrix );
+void RendererGL::governShadowQuality()
+{
+   if (!UseShadowQualityGovernor) return;
+
+   // the timers report a few frames late, so the measurements right after a change still belong to the old level.
+   if (GovernorCooldownFrameNum > 0) {
+      GovernorCooldownFrameNum--;
+      return;
+   }
+
+   const double frame_time =
+      LightPassTimer->getElapsedTimeInMilliseconds() + ScenePassTimer->getElapsedTimeInMilliseconds();
+   if (frame_time > FrameTimeBudget * OverBudgetRatio) {
+      OverBudgetFrameNum++;
+      UnderBudgetFrameNum = 0;
    }
+   else if (frame_time < FrameTimeBudget * UnderBudgetRatio) {
+      UnderBudgetFrameNum++;
+      OverBudgetFrameNum = 0;
+   }
+   else OverBudgetFrameNum = UnderBudgetFrameNum = 0;
+
+   int level_index = ShadowQualityLevelIndex;
+   if (OverBudgetFrameNum >= OverBudgetFrameThreshold) level_index--;
+   else if (UnderBudgetFrameNum >= UnderBudgetFrameThreshold) level_index++;
+   level_index = std::clamp( level_index, 0, static_cast<int>(ShadowQualityLevels.size()) - 1 );
+   if (level_index == ShadowQualityLevelIndex) return;
+
+   applyShadowQualityLevel( level_index );
+   GovernorCooldownFrameNum = GovernorCooldownFrames;
+   OverBudgetFrameNum = UnderBudgetFrameNum = 0;
 }
 
 void RendererGL::generateSummedAreaTable() const
 {
-   glm::ivec2 offsets(0, 0);
-   constexpr int samples = 4;
-   const int g = getGroupSize( ShadowMapSize );
-   glUseProgram( SATShader->getShaderProgram() );
-   SATShader->uniform1i( "Size", ShadowMapSize );
+   ShaderGL* shader = UseIntegerSAT ? IntegerSATShader.get() : SATShader.get();
+   dispatchSummedAreaTable( shader, ShadowMapSize, MomentsTextureID, UseIntegerSAT ? IntegerSATTextureID : 0 );
+}
 
-   // textures must be set to GL_CLAMP_TO_BORDER with the border value 0.
-   int t = 0;
-   const std::array<GLuint, 2> textures = { SATTextureID, MomentsTextureID };
-   for (int i = 1; i < ShadowMapSize; i *= samples) {
-      offsets.x = i;
-      SATShader->uniform2iv( "Offsets", offsets );
-      glBindImageTexture( 0, textures[t], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F );
-      glBindImageTexture( 1, textures[t ^ 1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F );
-      glDispatchCompute( g, g, 1 );
-      glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
-      t ^= 1;
+void RendererGL::dispatchSummedAreaTable(
+   ShaderGL* shader,
+   int size,
+   GLuint moments_texture_id,
+   GLuint integer_sat_texture_id
+)
+{
+   // the rows and then the columns are scanned in place, so the whole table takes only two passes over the image.
+   const int g = getGroupSize( size );
+   glUseProgram( shader->getShaderProgram() );
+   shader->uniform1i( UNIFORM::Size, size );
+   if (integer_sat_texture_id != 0) {
+      // the row pass reads the moments with the mean from the top of the mip chain and writes the fixed-point sums.
+      glGenerateTextureMipmap( moments_texture_id );
+      shader->uniform1i( UNIFORM::MeanLevel, getMipLevelNum( size ) - 1 );
+      shader->uniform1f( UNIFORM::FixedPointScale, static_cast<float>(1 << IntegerSATFractionBits) );
+      glBindTextureUnit( 0, moments_texture_id );
+      glBindImageTexture( 0, integer_sat_texture_id, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32UI );
    }
+   else glBindImageTexture( 0, moments_texture_id, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F );
+
+   shader->uniform2iv( UNIFORM::Direction, glm::ivec2(1, 0) );
+   glDispatchCompute( g, 1, 1 );
+   glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+
+   shader->uniform2iv( UNIFORM::Direction, glm::ivec2(0, 1) );
+   glDispatchCompute( g, 1, 1 );
+   glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT );
+}
+
+void RendererGL::generateCascadeSummedAreaTables(int split_mask) const
+{
+   // every layer of the array is scanned by the same dispatch, and the cascades out of the mask return at once.
+   const int g = getGroupSize( ShadowMapSize );
+   glUseProgram( CascadeSATShader->getShaderProgram() );
+   CascadeSATShader->uniform1i( UNIFORM::Size, ShadowMapSize );
+   CascadeSATShader->uniform1i( UNIFORM::SplitMask, split_mask );
+   glBindImageTexture( 0, MomentsTextureArrayID, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RG32F );
+
+   CascadeSATShader->uniform2iv( UNIFORM::Direction, glm::ivec2(1, 0) );
+   glDispatchCompute( g, 1, SplitNum );
+   glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+
+   CascadeSATShader->uniform2iv( UNIFORM::Direction, glm::ivec2(0, 1) );
+   glDispatchCompute( g, 1, SplitNum );
+   glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT );
+}
+
+void RendererGL::drawGeometryBuffers() const
+{
+   glViewport( 0, 0, FrameWidth, FrameHeight );
+   glBindFramebuffer( GL_FRAMEBUFFER, GBufferFBO );
+
+   // only the depth is cleared because the lighting pass skips the pixels at the far plane.
+   constexpr GLfloat one = 1.0f;
+   glClearNamedFramebufferfv( GBufferFBO, GL_DEPTH, 0, &one );
+
+   glUseProgram( GBufferShader->getShaderProgram() );
+   GBufferShader->uniform1ui( UNIFORM::MaterialID, ObjectMaterialID );
+   drawObject( GBufferShader.get(), MainCamera.get() );
+   GBufferShader->uniform1ui( UNIFORM::MaterialID, WallMaterialID );
+   drawBoxObject( GBufferShader.get(), MainCamera.get() );
+}
+
+void RendererGL::drawSceneDepth() const
+{
+   glViewport( 0, 0, FrameWidth, FrameHeight );
+   glBindFramebuffer( GL_FRAMEBUFFER, SceneDepthFBO );
 
-   offsets.x = 0;
-   for (int i = 1; i < ShadowMapSize; i *= samples) {
-      offsets.y = i;
-      SATShader->uniform2iv( "Offsets", offsets );
-      glBindImageTexture( 0, textures[t], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F );
-      glBindImageTexture( 1, textures[t ^ 1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F );
-      glDispatchCompute( g, g, 1 );
-      glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
-      t ^= 1;
+   constexpr GLfloat one = 1.0f;
+   glClearNamedFramebufferfv( SceneDepthFBO, GL_DEPTH, 0, &one );
+
+   glUseProgram( LightViewDepthShader->getShaderProgram() );
+   drawObject( LightViewDepthShader.get(), MainCamera.get() );
+   drawBoxObject( LightViewDepthShader.get(), MainCamera.get() );
+}
+
+void RendererGL::reduceSceneDepth() const
+{
+   glUseProgram( DepthBoundsShader->getShaderProgram() );
+   DepthBoundsShader->uniformMat4fv( UNIFORM::ProjectionMatrix, MainCamera->getProjectionMatrix() );
+   glBindTextureUnit( 0, GBufferDepthTextureID );
+   SceneDepthBounds->reduce( FrameWidth, FrameHeight );
+}
+
+void RendererGL::cullClusteredLights() const
+{
+   // the lights are uploaded in the eye coordinates, so the clusters are bounded in the view space.
+   ClusteredLights->updateLightStorageBuffer( MainCamera->getViewMatrix() );
+   glUseProgram( LightCullingShader->getShaderProgram() );
+   LightCullingShader->uniformMat4fv(
+      UNIFORM::InverseProjectionMatrix, glm::inverse( MainCamera->getProjectionMatrix() )
+   );
+   LightCullingShader->uniform3iv( UNIFORM::ClusterGridSize, LightClusterGL::getGridSize() );
+   LightCullingShader->uniform2fv(
+      UNIFORM::ClusterDepthRange, glm::vec2(MainCamera->getNearPlane(), MainCamera->getFarPlane())
+   );
+   LightCullingShader->uniform1i( UNIFORM::LightNum, ClusteredLights->getTotalLightNum() );
+   LightClusters->cull();
+}
+
+void RendererGL::drawScene(ShaderGL* shader) const
+{
+   if (!UseDeferredShading) {
+      drawObject( shader, MainCamera.get() );
+      drawBoxObject( shader, MainCamera.get() );
+      return;
    }
 
-   assert( t == 0 );
+   // a single full-screen triangle shades each pixel once, so the cost of the shadow filter no longer grows with
+   // the overdraw of the objects.
+   shader->uniformMat4fv( UNIFORM::InverseViewMatrix, glm::inverse( MainCamera->getViewMatrix() ) );
+   shader->uniformMat4fv( UNIFORM::InverseProjectionMatrix, glm::inverse( MainCamera->getProjectionMatrix() ) );
+   glBindTextureUnit( 1, GBufferDepthTextureID );
+   glBindTextureUnit( 2, GBufferNormalTextureID );
+   glBindTextureUnit( 3, GBufferMaterialTextureID );
+
+   glDisable( GL_DEPTH_TEST );
+   glBindVertexArray( FullScreenVAO );
+   glDrawArrays( GL_TRIANGLES, 0, 3 );
+   glEnable( GL_DEPTH_TEST );
 }
 
 void RendererGL::drawShadowWithPCF() const
 {
    glViewport( 0, 0, FrameWidth, FrameHeight );
    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-   glUseProgram( PCFSceneShader->getShaderProgram() );
+   ShaderGL* shader = UseDeferredShading ? DeferredPCFSceneShader : PCFSceneShader;
+   glUseProgram( shader->getShaderProgram() );
 
-   Lights->transferUniformsToShader( PCFSceneShader.get() );
-   PCFSceneShader->uniform1i( "LightIndex", ActiveLightIndex );
+   shader->uniform1i( UNIFORM::LightIndex, ActiveLightIndex );
 
    const glm::mat4 view_projection = LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix();
-   PCFSceneShader->uniformMat4fv( "LightViewProjectionMatrix", view_projection );
+   shader->uniformMat4fv( UNIFORM::LightViewProjectionMatrix, view_projection );
 
    glBindTextureUnit( 0, DepthTextureID );
-   drawObject( PCFSceneShader.get(), MainCamera.get() );
-   drawBoxObject( PCFSceneShader.get(), MainCamera.get() );
+   drawScene( shader );
 }
 
 void RendererGL::drawShadowWithVSM() const
 {
    glViewport( 0, 0, FrameWidth, FrameHeight );
    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-   glUseProgram( VSMSceneShader->getShaderProgram() );
+   ShaderGL* shader = UseDeferredShading ? DeferredVSMSceneShader.get() : VSMSceneShader.get();
+   if (UseShadowedLights) {
+      shader = UseDeferredShading ? DeferredShadowedLightsSceneShader.get() : ShadowedLightsSceneShader.get();
+   }
+   if (UseClusteredLights) {
+      shader = UseDeferredShading ? DeferredClusteredLightsSceneShader : ClusteredLightsSceneShader;
+   }
+   glUseProgram( shader->getShaderProgram() );
 
-   Lights->transferUniformsToShader( VSMSceneShader.get() );
-   VSMSceneShader->uniform1i( "LightIndex", ActiveLightIndex );
+   shader->uniform1i( UNIFORM::LightIndex, ActiveLightIndex );
+   shader->uniform1f( UNIFORM::MinVariance, getMinVariance() );
 
-   const glm::mat4 view_projection = LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix();
-   VSMSceneShader->uniformMat4fv( "LightViewProjectionMatrix", view_projection );
+   if (UseShadowedLights) {
+      shader->uniformMat4fv( UNIFORM::ShadowedLightMatrices, ShadowedLightMatrices );
+      shader->uniform1fv(
+         UNIFORM::ShadowedLightFarPlanes, static_cast<int>(ShadowedLightFarPlanes.size()), ShadowedLightFarPlanes.data()
+      );
+      shader->uniform4fv(
+         UNIFORM::ShadowTiles, static_cast<int>(ShadowedLightTiles.size()), &ShadowedLightTiles[0][0]
+      );
+      glBindTextureUnit( 0, ShadowAtlasTextureID );
+   }
+   else {
+      const glm::mat4 view_projection = LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix();
+      shader->uniformMat4fv( UNIFORM::LightViewProjectionMatrix, view_projection );
+      glBindTextureUnit( 0, MomentsTextureID );
+   }
 
-   glBindTextureUnit( 0, MomentsTextureID );
-   drawObject( VSMSceneShader.get(), MainCamera.get() );
-   drawBoxObject( VSMSceneShader.get(), MainCamera.get() );
+   if (UseClusteredLights) {
+      const glm::ivec3 grid_size = LightClusterGL::getGridSize();
+      shader->uniform3iv( UNIFORM::ClusterGridSize, grid_size );
+      shader->uniform2fv(
+         UNIFORM::ClusterDepthRange, glm::vec2(MainCamera->getNearPlane(), MainCamera->getFarPlane())
+      );
+      shader->uniform2fv(
+         UNIFORM::ClusterTileSize,
+         glm::vec2(FrameWidth, FrameHeight) / glm::vec2(grid_size.x, grid_size.y)
+      );
+   }
+   drawScene( shader );
 }
 
 void RendererGL::drawShadowWithPSVSM() const
 {
    glViewport( 0, 0, FrameWidth, FrameHeight );
    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-   glUseProgram( PSVSMSceneShader->getShaderProgram() );
+   ShaderGL* shader = UseDeferredShading ? DeferredPSVSMSceneShader : PSVSMSceneShader;
+   glUseProgram( shader->getShaderProgram() );
+
+   shader->uniform1i( UNIFORM::LightIndex, ActiveLightIndex );
+   shader->uniform1f( UNIFORM::MinVariance, getMinVariance() );
+
+   shader->uniform1fv( UNIFORM::SplitPositions, SplitNum, SplitPositions.data() );
+   shader->uniformMat4fv( UNIFORM::LightViewProjectionMatrix, RenderedLightViewProjectionMatrices );
+   shader->uniform1i( UNIFORM::UseSAT, UseCascadeSAT ? 1 : 0 );
+   shader->uniform1f( UNIFORM::MaxFilterSize, static_cast<float>(getSATMaxFilterSize( false )) );
+
+   if (UseCascadeAtlas) {
+      // the tiles are given as their offsets and sizes in the texture coordinates of the atlas.
+      const glm::vec2 atlas_size(CascadeAtlasSize);
+      std::vector<glm::vec4> atlas_tiles;
+      for (const auto& tile : CascadeAtlasTiles) {
+         atlas_tiles.emplace_back( glm::vec4(tile) / glm::vec4(atlas_size, atlas_size) );
+      }
+      shader->uniform4fv( UNIFORM::AtlasTiles, SplitNum, &atlas_tiles[0][0] );
+      glBindTextureUnit( 0, MomentsAtlasTextureID );
+   }
+   else glBindTextureUnit( 0, MomentsTextureArrayID );
+   drawScene( shader );
+}
 
-   Lights->transferUniformsToShader( PSVSMSceneShader.get() );
-   PSVSMSceneShader->uniform1i( "LightIndex", ActiveLightIndex );
-   PSVSMSceneShader->uniform1fv( "SplitPositions", SplitNum, SplitPositions.data() );
-   PSVSMSceneShader->uniformMat4fv( "LightViewProjectionMatrix", LightViewProjectionMatrices );
+void RendererGL::drawShadowWithSATVSM() const
+{
+   glViewport( 0, 0, FrameWidth, FrameHeight );
+   glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   ShaderGL* shader = UseDeferredShading ? DeferredSATVSMSceneShader.get() : SATVSMSceneShader.get();
+   glUseProgram( shader->getShaderProgram() );
+
+   shader->uniform1i( UNIFORM::LightIndex, ActiveLightIndex );
+
+   const glm::mat4 view_projection = LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix();
+   shader->uniformMat4fv( UNIFORM::LightViewProjectionMatrix, view_projection );
+   shader->uniform1f( UNIFORM::MaxFilterSize, static_cast<float>(getSATMaxFilterSize( UseIntegerSAT )) );
+   shader->uniform1i( UNIFORM::UseIntegerSAT, UseIntegerSAT ? 1 : 0 );
+   shader->uniform1i( UNIFORM::UseTextureGather, UseTextureGather ? 1 : 0 );
+   shader->uniform1i( UNIFORM::MeanLevel, getMipLevelNum( ShadowMapSize ) - 1 );
+   shader->uniform1f( UNIFORM::FixedPointScale, static_cast<float>(1 << IntegerSATFractionBits) );
 
-   glBindTextureUnit( 0, MomentsTextureArrayID );
-   drawObject( PSVSMSceneShader.get(), MainCamera.get() );
-   drawBoxObject( PSVSMSceneShader.get(), MainCamera.get() );
+   glBindTextureUnit( 0, MomentsTextureID );
+   if (UseIntegerSAT) glBindTextureUnit( 4, IntegerSATTextureID );
+   drawScene( shader );
 }
 
-void RendererGL::drawShadowWithSATVSM() const
+void RendererGL::drawShadowWithEVSM() const
 {
    glViewport( 0, 0, FrameWidth, FrameHeight );
    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-   glUseProgram( SATVSMSceneShader->getShaderProgram() );
+   ShaderGL* shader = UseDeferredShading ? DeferredEVSMSceneShader.get() : EVSMSceneShader.get();
+   glUseProgram( shader->getShaderProgram() );
 
-   Lights->transferUniformsToShader( SATVSMSceneShader.get() );
-   SATVSMSceneShader->uniform1i( "LightIndex", ActiveLightIndex );
+   shader->uniform1i( UNIFORM::LightIndex, ActiveLightIndex );
+   shader->uniform1f( UNIFORM::MinVariance, getMinVariance() );
+   shader->uniform2fv( UNIFORM::Exponents, glm::vec2(EVSMPositiveExponent, EVSMNegativeExponent) );
+   shader->uniform1i( UNIFORM::UseNegativeMoments, MomentsFormat == GL_RGBA16F ? 1 : 0 );
 
    const glm::mat4 view_projection = LightCamera->getProjectionMatrix() * LightCamera->getViewMatrix();
-   SATVSMSceneShader->uniformMat4fv( "LightViewProjectionMatrix", view_projection );
+   shader->uniformMat4fv( UNIFORM::LightViewProjectionMatrix, view_projection );
 
    glBindTextureUnit( 0, MomentsTextureID );
-   drawObject( SATVSMSceneShader.get(), MainCamera.get() );
-   drawBoxObject( SATVSMSceneShader.get(), MainCamera.get() );
+   drawScene( shader );
+}
+
+void RendererGL::drawShadowWithOVSM() const
+{
+   glViewport( 0, 0, FrameWidth, FrameHeight );
+   glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   ShaderGL* shader = UseDeferredShading ? DeferredOVSMSceneShader.get() : OVSMSceneShader.get();
+   glUseProgram( shader->getShaderProgram() );
+
+   shader->uniform1i( UNIFORM::LightIndex, PointLightIndex );
+   shader->uniform1f( UNIFORM::MinVariance, getMinVariance() );
+   shader->uniform3fv( UNIFORM::LightPosition, glm::vec3(Lights->getLightPosition( PointLightIndex )) );
+   shader->uniform1f( UNIFORM::LightFarPlane, PointLightFarPlane );
+
+   glBindTextureUnit( 0, MomentsCubeTextureID );
+   drawScene( shader );
 }
 
 void RendererGL::drawText(const std::string& text, glm::vec2 start_position) const
@@ -717,7 +2482,7 @@ void RendererGL::drawText(const std::string& text, glm::vec2 start_position) con
          glm::translate( glm::mat4(1.0f), glm::vec3(position, 0.0f) ) *
          glm::scale( glm::mat4(1.0f), glm::vec3(glyph->Size.x, glyph->Size.y, 1.0f) );
       TextShader->transferBasicTransformationUniforms( to_world, TextCamera.get() );
-      TextShader->uniform2fv( "TextScale", glyph->TopRightTextureCoord );
+      TextShader->uniform2fv( UNIFORM::TextScale, glyph->TopRightTextureCoord );
       glBindTextureUnit( 0, glyph_object->getTextureID( glyph->TextureIDIndex ) );
       glDrawArrays( glyph_object->getDrawMode(), 0, glyph_object->getVertexNum() );
 
@@ -732,35 +2497,101 @@ void RendererGL::render()
 {
    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+   if (MomentsFormat != getMomentsFormat()) {
+      deleteLightViewFrameBuffers();
+      setLightViewFrameBuffers();
+   }
+
    LightCamera->updateCameraView(
       glm::vec3(Lights->getLightPosition( ActiveLightIndex )),
       glm::vec3(0.0f, 0.0f, 0.0f),
       glm::vec3(0.0f, 1.0f, 0.0f)
    );
+   fitLightDepthRangeToScene( LightCamera.get() );
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::OVSM) updatePointLightFaces();
 
    std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
 
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+      splitViewFrustum();
+      calculateLightCropMatrices();
+   }
+
+   const ShadowMapState shadow_map_state = getShadowMapState();
+   const bool is_state_changed = !(CachedShadowMapState == shadow_map_state);
+   bool is_cached = UseShadowCache && !is_state_changed;
+   int split_mask = 0;
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+      split_mask = scheduleCascadeUpdates( is_state_changed );
+      is_cached = split_mask == 0;
+   }
+   if (UseShadowCache) {
+      ShadowCacheQueryNum++;
+      if (is_cached) ShadowCacheHitNum++;
+   }
+
+   LightPassTimer->begin();
+   if (!is_cached) {
+      switch (AlgorithmToCompare) {
+         case ALGORITHM_TO_COMPARE::PCF:
+            drawDepthMapFromLightView();
+            break;
+         case ALGORITHM_TO_COMPARE::VSM:
+            // the shadowed lights keep their own maps in the shadow atlas.
+            if (UseShadowedLights) break;
+            drawMomentsMapFromLightView();
+            filterMomentsMap();
+            break;
+         case ALGORITHM_TO_COMPARE::PSVSM:
+            if (UseCascadeAtlas) drawMomentsAtlasFromLightView( split_mask );
+            else if (UseLayeredCascades) drawMomentsArrayMapFromLightViewInSinglePass( split_mask );
+            else drawMomentsArrayMapFromLightView( split_mask );
+            if (UseCascadeSAT) generateCascadeSummedAreaTables( split_mask );
+            break;
+         case ALGORITHM_TO_COMPARE::SATVSM:
+            drawMomentsMapFromLightView();
+            generateSummedAreaTable();
+            break;
+         case ALGORITHM_TO_COMPARE::EVSM:
+            drawExponentialMomentsMapFromLightView();
+            filterMomentsMap();
+            break;
+         case ALGORITHM_TO_COMPARE::OVSM:
+            drawMomentsCubeMapFromPointLight();
+            filterMomentsCubeMap();
+            break;
+      }
+      CachedShadowMapState = shadow_map_state;
+   }
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM && UseShadowedLights) {
+      updateShadowedLights();
+      drawShadowAtlasFromLights();
+   }
+   LightPassTimer->end();
+
+   ScenePassTimer->begin();
+   Lights->updateLightBuffer( MainCamera->getViewMatrix() );
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM && UseClusteredLights) cullClusteredLights();
+   // the forward shading draws only the depth of the geometry buffers when the splits follow the visible depths.
+   const bool use_sample_distribution =
+      UseSampleDistribution && AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM;
+   if (UseDeferredShading) drawGeometryBuffers();
+   else if (use_sample_distribution) drawSceneDepth();
+   if (use_sample_distribution) reduceSceneDepth();
    switch (AlgorithmToCompare) {
-      case ALGORITHM_TO_COMPARE::PCF:
-         drawDepthMapFromLightView();
-         drawShadowWithPCF();
-         break;
-      case ALGORITHM_TO_COMPARE::VSM:
-         drawMomentsMapFromLightView();
-         drawShadowWithVSM();
-         break;
-      case ALGORITHM_TO_COMPARE::PSVSM:
-         splitViewFrustum();
-         calculateLightCropMatrices();
-         drawMomentsArrayMapFromLightView();
-         drawShadowWithPSVSM();
-         break;
-      case ALGORITHM_TO_COMPARE::SATVSM:
-         drawMomentsMapFromLightView();
-         generateSummedAreaTable();
-         drawShadowWithSATVSM();
-         break;
+      case ALGORITHM_TO_COMPARE::PCF: drawShadowWithPCF(); break;
+      case ALGORITHM_TO_COMPARE::VSM: drawShadowWithVSM(); break;
+      case ALGORITHM_TO_COMPARE::PSVSM: drawShadowWithPSVSM(); break;
+      case ALGORITHM_TO_COMPARE::SATVSM: drawShadowWithSATVSM(); break;
+      case ALGORITHM_TO_COMPARE::EVSM: drawShadowWithEVSM(); break;
+      case ALGORITHM_TO_COMPARE::OVSM: drawShadowWithOVSM(); break;
    }
+   ScenePassTimer->end();
+   ShadowPassTimes[{ AlgorithmToCompare, MomentsFormat }] = {
+      LightPassTimer->getElapsedTimeInMilliseconds(), ScenePassTimer->getElapsedTimeInMilliseconds()
+   };
+   FrameIndex++;
+   governShadowQuality();
 
    std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
    const auto fps = 1E+6 / static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
@@ -770,8 +2601,93 @@ void RendererGL::render()
    else if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM) text << "Variance Shadow Map\n";
    else if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) text << "Parallel-Split Variance Shadow Map\n";
    else if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) text << "Summed Area Table Variance Shadow Map\n";
-   text << std::fixed << std::setprecision( 2 ) << fps << " fps";
-   drawText( text.str(), { 80.0f, 100.0f } );
+   else if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::EVSM) text << "Exponential Variance Shadow Map\n";
+   else if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::OVSM) text << "Omnidirectional Variance Shadow Map\n";
+   text << std::fixed << std::setprecision( 2 ) << fps << " fps\n";
+   text << "Light Pass: " << LightPassTimer->getElapsedTimeInMilliseconds() << " ms, ";
+   text << "Scene Pass" << (UseDeferredShading ? " (Deferred): " : ": ");
+   text << ScenePassTimer->getElapsedTimeInMilliseconds() << " ms\n";
+
+   constexpr double to_megabytes = 1.0 / (1024.0 * 1024.0);
+   const auto memory_size = static_cast<double>(getShadowMapMemorySize( MomentsFormat ));
+   const auto full_precision_memory_size = static_cast<double>(getShadowMapMemorySize( GL_RG32F ));
+   text << "Shadow Map: " << ShadowMapSize << "x" << ShadowMapSize << ", ";
+   text << getFormatString( MomentsFormat ) << ", " << memory_size * to_megabytes << " MB ";
+   text << "(-" << (1.0 - memory_size / full_precision_memory_size) * 100.0 << "%";
+   const auto full_precision_times = ShadowPassTimes.find( { AlgorithmToCompare, GL_RG32F } );
+   if (MomentsFormat != GL_RG32F && full_precision_times != ShadowPassTimes.end()) {
+      // the saving is weighed against the pass times last measured with the same algorithm in RG32F.
+      const auto& times = ShadowPassTimes[{ AlgorithmToCompare, MomentsFormat }];
+      text << std::showpos << ", Light " << times.first - full_precision_times->second.first << " ms, ";
+      text << "Scene " << times.second - full_precision_times->second.second << " ms" << std::noshowpos;
+      text << " vs RG32F";
+   }
+   text << ")\n";
+
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::EVSM || AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) {
+      // the pass times are the last ones measured while each algorithm was selected with these formats.
+      const auto getPassTime = [this](ALGORITHM_TO_COMPARE algorithm, GLenum format) {
+         const auto times = ShadowPassTimes.find( { algorithm, format } );
+         return times != ShadowPassTimes.end() ? times->second.first + times->second.second : 0.0;
+      };
+      const GLenum evsm_format = UseEVSMPositiveOnly ? GL_RG16F : GL_RGBA16F;
+      const auto evsm_size = static_cast<double>(getAlgorithmMemorySize( ALGORITHM_TO_COMPARE::EVSM, evsm_format ));
+      const auto sat_size = static_cast<double>(getAlgorithmMemorySize( ALGORITHM_TO_COMPARE::SATVSM, GL_RG32F ));
+      text << "EVSM(" << getFormatString( evsm_format ) << "): " << evsm_size * to_megabytes << " MB, ";
+      text << getPassTime( ALGORITHM_TO_COMPARE::EVSM, evsm_format ) << " ms / ";
+      text << "SATVSM: " << sat_size * to_megabytes << " MB, ";
+      text << getPassTime( ALGORITHM_TO_COMPARE::SATVSM, GL_RG32F ) << " ms\n";
+   }
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::SATVSM) {
+      // four bilinear taps of four corners each, as single texels or as 2x2 quads of one channel.
+      // the fixed-point table reads the mean once more.
+      const int request_num = (UseTextureGather ? 8 : 16) + (UseIntegerSAT ? 1 : 0);
+      const int byte_num = 16 * getBytesPerTexel( GL_RG32F ) + (UseIntegerSAT ? getBytesPerTexel( GL_RG32F ) : 0);
+      text << "SAT Lookup: " << (UseTextureGather ? "Gather, " : "Fetch, ") << request_num << " requests, ";
+      text << byte_num << " B / fragment, Table: " << (UseIntegerSAT ? "Fixed-Point RG32UI\n" : "RG32F (i: RG32UI)\n");
+   }
+
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM && UseShadowedLights) {
+      const auto atlas_size = static_cast<double>(ShadowAtlasSize) * static_cast<double>(ShadowAtlasSize) *
+         static_cast<double>(getBytesPerTexel( GL_RG32F ) + getBytesPerTexel( GL_DEPTH_COMPONENT32F ));
+      text << "Shadowed Lights: " << LightShadowAtlas->getAllocationNum() << ", ";
+      text << "Tiles Rendered: " << DirtyShadowTiles.size() << ", ";
+      text << "Atlas: " << ShadowAtlasSize << "x" << ShadowAtlasSize << ", " << atlas_size * to_megabytes << " MB, ";
+      text << LightShadowAtlas->getUsedTexelRatioInPercent() << "% used\n";
+   }
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::VSM && UseClusteredLights) {
+      const glm::ivec3 grid_size = LightClusterGL::getGridSize();
+      text << "Clustered Lights: " << ClusteredLights->getTotalLightNum() << ", ";
+      text << "Clusters: " << grid_size.x << "x" << grid_size.y << "x" << grid_size.z << ", ";
+      text << "<= " << LightClusterGL::getMaxLightNumPerCluster() << " lights / cluster\n";
+   }
+
+   text << "Shadow Cache: ";
+   if (UseShadowCache) {
+      const double hit_rate = ShadowCacheQueryNum > 0 ?
+         static_cast<double>(ShadowCacheHitNum) / static_cast<double>(ShadowCacheQueryNum) : 0.0;
+      text << hit_rate * 100.0 << "% hit";
+   }
+   else text << "Off";
+   if (AlgorithmToCompare == ALGORITHM_TO_COMPARE::PSVSM) {
+      text << ", Cascades Updated: " << std::bitset<32>(split_mask).count() << "/" << SplitNum;
+      text << " (every " << CascadeUpdateInterval << " frames)";
+      if (UseCascadeSAT) text << ", SAT";
+      if (UseCascadeAtlas) text << ", Atlas " << CascadeAtlasSize.x << "x" << CascadeAtlasSize.y;
+      if (UseSampleDistribution) {
+         text << ", Depth: " << SplitPositions.front() << " - " << SplitPositions.back();
+      }
+   }
+   text << "\nQuality: PCF <= " << PCFMaxFilterSize << ", SAT <= " << getSATMaxFilterSize( UseIntegerSAT );
+   text << (UseIntegerSAT ? " (RG32UI)" : " (RG32F)") << ", Splits: " << SplitNum;
+   text << ", Cascade Interval: " << CascadeUpdateInterval << "\n";
+   text << "Governor: ";
+   if (UseShadowQualityGovernor) {
+      text << "Level " << ShadowQualityLevelIndex + 1 << "/" << ShadowQualityLevels.size();
+      text << ", Budget " << FrameTimeBudget << " ms";
+   }
+   else text << "Off";
+   drawText( text.str(), { 80.0f, 280.0f } );
 }
 
 void RendererGL::play()
@@ -782,15 +2698,8 @@ void RendererGL::play()
    setObject();
    setWallObject();
    setLightViewFrameBuffers();
-   TextShader->setTextUniformLocations();
-   PCFSceneShader->setSceneUniformLocations( 1 );
-   VSMSceneShader->setSceneUniformLocations( 1 );
-   PSVSMSceneShader->setPSSMSceneUniformLocations( 1 );
-   SATVSMSceneShader->setSceneUniformLocations( 1 );
-   LightViewDepthShader->setLightViewUniformLocations();
-   LightViewMomentsShader->setLightViewUniformLocations();
-   LightViewMomentsArrayShader->setLightViewArrayUniformLocations();
-   SATShader->setSATUniformLocations();
+   setGeometryBuffers();
+   setMaterialBuffer();
 
    while (!glfwWindowShouldClose( Window )) {
       if (!Pause) render();
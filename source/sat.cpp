@@ -0,0 +1,517 @@
+#include "sat.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SAT_USE_SSE
+#include <immintrin.h>
+#if defined(__GNUC__)
+// the avx2 kernels are compiled for their own target and chosen at runtime, so the binary still runs anywhere.
+#define SAT_USE_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+   template<typename T>
+   void scanRowScalar(T* row, int begin, int size, T carry_x, T carry_y)
+   {
+      for (int i = begin; i < size; ++i) {
+         carry_x += row[i * 2];
+         carry_y += row[i * 2 + 1];
+         row[i * 2] = carry_x;
+         row[i * 2 + 1] = carry_y;
+      }
+   }
+
+   template<typename T>
+   void addRowScalar(T* row, const T* previous_row, int begin, int count)
+   {
+      for (int i = begin; i < count; ++i) row[i] += previous_row[i];
+   }
+
+#ifdef SAT_USE_SSE
+   // a register holds two rg pairs, so the first pair is shifted onto the second one before the carry is added.
+   void scanRowSSE(float* row, int size)
+   {
+      __m128 carry = _mm_setzero_ps();
+      int i = 0;
+      for (; i + 2 <= size; i += 2) {
+         __m128 x = _mm_loadu_ps( row + i * 2 );
+         x = _mm_add_ps( x, _mm_castsi128_ps( _mm_slli_si128( _mm_castps_si128( x ), 8 ) ) );
+         x = _mm_add_ps( x, carry );
+         _mm_storeu_ps( row + i * 2, x );
+         carry = _mm_movehl_ps( x, x );
+      }
+      const float carry_x = _mm_cvtss_f32( carry );
+      const float carry_y = _mm_cvtss_f32( _mm_shuffle_ps( carry, carry, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+      scanRowScalar( row, i, size, carry_x, carry_y );
+   }
+
+   void scanRowSSE(uint32_t* row, int size)
+   {
+      __m128i carry = _mm_setzero_si128();
+      int i = 0;
+      for (; i + 2 <= size; i += 2) {
+         auto* address = reinterpret_cast<__m128i*>(row + i * 2);
+         __m128i x = _mm_loadu_si128( address );
+         x = _mm_add_epi32( x, _mm_slli_si128( x, 8 ) );
+         x = _mm_add_epi32( x, carry );
+         _mm_storeu_si128( address, x );
+         carry = _mm_shuffle_epi32( x, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+      }
+      const auto carry_x = static_cast<uint32_t>(_mm_cvtsi128_si32( carry ));
+      const auto carry_y = static_cast<uint32_t>(_mm_cvtsi128_si32( _mm_shuffle_epi32( carry, 1 ) ));
+      scanRowScalar( row, i, size, carry_x, carry_y );
+   }
+
+   void addRowSSE(float* row, const float* previous_row, int count)
+   {
+      int i = 0;
+      for (; i + 4 <= count; i += 4) {
+         _mm_storeu_ps( row + i, _mm_add_ps( _mm_loadu_ps( row + i ), _mm_loadu_ps( previous_row + i ) ) );
+      }
+      addRowScalar( row, previous_row, i, count );
+   }
+
+   void addRowSSE(uint32_t* row, const uint32_t* previous_row, int count)
+   {
+      int i = 0;
+      for (; i + 4 <= count; i += 4) {
+         auto* address = reinterpret_cast<__m128i*>(row + i);
+         const auto* previous_address = reinterpret_cast<const __m128i*>(previous_row + i);
+         _mm_storeu_si128( address, _mm_add_epi32( _mm_loadu_si128( address ), _mm_loadu_si128( previous_address ) ) );
+      }
+      addRowScalar( row, previous_row, i, count );
+   }
+#endif
+
+#ifdef SAT_USE_AVX2
+   // the shift only works within each 128-bit lane, so the last pair of the lower lane is added to the upper lane.
+   AVX2_TARGET void scanRowAVX2(float* row, int size)
+   {
+      const __m256i lower_last_pair = _mm256_setr_epi32( 0, 0, 0, 0, 2, 3, 2, 3 );
+      const __m256i last_pair = _mm256_setr_epi32( 6, 7, 6, 7, 6, 7, 6, 7 );
+      __m256 carry = _mm256_setzero_ps();
+      int i = 0;
+      for (; i + 4 <= size; i += 4) {
+         __m256 x = _mm256_loadu_ps( row + i * 2 );
+         x = _mm256_add_ps( x, _mm256_castsi256_ps( _mm256_slli_si256( _mm256_castps_si256( x ), 8 ) ) );
+         x = _mm256_add_ps(
+            x, _mm256_blend_ps( _mm256_setzero_ps(), _mm256_permutevar8x32_ps( x, lower_last_pair ), 0xF0 )
+         );
+         x = _mm256_add_ps( x, carry );
+         _mm256_storeu_ps( row + i * 2, x );
+         carry = _mm256_permutevar8x32_ps( x, last_pair );
+      }
+      const __m128 lower_carry = _mm256_castps256_ps128( carry );
+      const float carry_x = _mm_cvtss_f32( lower_carry );
+      const float carry_y = _mm_cvtss_f32( _mm_shuffle_ps( lower_carry, lower_carry, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+      scanRowScalar( row, i, size, carry_x, carry_y );
+   }
+
+   AVX2_TARGET void scanRowAVX2(uint32_t* row, int size)
+   {
+      const __m256i lower_last_pair = _mm256_setr_epi32( 0, 0, 0, 0, 2, 3, 2, 3 );
+      const __m256i last_pair = _mm256_setr_epi32( 6, 7, 6, 7, 6, 7, 6, 7 );
+      __m256i carry = _mm256_setzero_si256();
+      int i = 0;
+      for (; i + 4 <= size; i += 4) {
+         auto* address = reinterpret_cast<__m256i*>(row + i * 2);
+         __m256i x = _mm256_loadu_si256( address );
+         x = _mm256_add_epi32( x, _mm256_slli_si256( x, 8 ) );
+         x = _mm256_add_epi32(
+            x, _mm256_blend_epi32( _mm256_setzero_si256(), _mm256_permutevar8x32_epi32( x, lower_last_pair ), 0xF0 )
+         );
+         x = _mm256_add_epi32( x, carry );
+         _mm256_storeu_si256( address, x );
+         carry = _mm256_permutevar8x32_epi32( x, last_pair );
+      }
+      const __m128i lower_carry = _mm256_castsi256_si128( carry );
+      const auto carry_x = static_cast<uint32_t>(_mm_cvtsi128_si32( lower_carry ));
+      const auto carry_y = static_cast<uint32_t>(_mm_cvtsi128_si32( _mm_shuffle_epi32( lower_carry, 1 ) ));
+      scanRowScalar( row, i, size, carry_x, carry_y );
+   }
+
+   AVX2_TARGET void addRowAVX2(float* row, const float* previous_row, int count)
+   {
+      int i = 0;
+      for (; i + 8 <= count; i += 8) {
+         _mm256_storeu_ps( row + i, _mm256_add_ps( _mm256_loadu_ps( row + i ), _mm256_loadu_ps( previous_row + i ) ) );
+      }
+      addRowScalar( row, previous_row, i, count );
+   }
+
+   AVX2_TARGET void addRowAVX2(uint32_t* row, const uint32_t* previous_row, int count)
+   {
+      int i = 0;
+      for (; i + 8 <= count; i += 8) {
+         auto* address = reinterpret_cast<__m256i*>(row + i);
+         const auto* previous_address = reinterpret_cast<const __m256i*>(previous_row + i);
+         _mm256_storeu_si256(
+            address, _mm256_add_epi32( _mm256_loadu_si256( address ), _mm256_loadu_si256( previous_address ) )
+         );
+      }
+      addRowScalar( row, previous_row, i, count );
+   }
+#endif
+
+   bool isAVX2Supported()
+   {
+#ifdef SAT_USE_AVX2
+      static const bool supported = __builtin_cpu_supports( "avx2" ) != 0;
+      return supported;
+#else
+      return false;
+#endif
+   }
+
+   template<typename T>
+   void scanRow(T* row, int size)
+   {
+#ifdef SAT_USE_AVX2
+      if (isAVX2Supported()) {
+         scanRowAVX2( row, size );
+         return;
+      }
+#endif
+#ifdef SAT_USE_SSE
+      scanRowSSE( row, size );
+#else
+      scanRowScalar( row, 0, size, T(0), T(0) );
+#endif
+   }
+
+   template<typename T>
+   void addRow(T* row, const T* previous_row, int count)
+   {
+#ifdef SAT_USE_AVX2
+      if (isAVX2Supported()) {
+         addRowAVX2( row, previous_row, count );
+         return;
+      }
+#endif
+#ifdef SAT_USE_SSE
+      addRowSSE( row, previous_row, count );
+#else
+      addRowScalar( row, previous_row, 0, count );
+#endif
+   }
+
+   // the depths change smoothly over the map like a real shadow map, and they cost almost nothing to generate.
+   template<typename T>
+   void fillMoments(std::vector<T>& moments, int size, const std::function<T(float)>& convert)
+   {
+      for (int y = 0; y < size; ++y) {
+         for (int x = 0; x < size; ++x) {
+            const float depth = 0.5f + 0.25f * std::sin( static_cast<float>(x) * 0.01f ) *
+               std::cos( static_cast<float>(y) * 0.013f ) + 0.2f * static_cast<float>((x ^ y) & 7) / 7.0f;
+            const size_t index = (static_cast<size_t>(y) * size + x) * 2;
+            moments[index] = convert( depth );
+            moments[index + 1] = convert( depth * depth );
+         }
+      }
+   }
+}
+
+SummedAreaTable::SummedAreaTable(int thread_num) :
+   ThreadNum( thread_num > 0 ? thread_num : std::max( static_cast<int>(std::thread::hardware_concurrency()), 1 ) )
+{
+}
+
+void SummedAreaTable::runInParallel(int task_num, const std::function<void(int, int)>& task) const
+{
+   const int thread_num = std::min( ThreadNum, task_num );
+   if (thread_num <= 1) {
+      task( 0, task_num );
+      return;
+   }
+
+   const int tasks_per_thread = (task_num + thread_num - 1) / thread_num;
+   std::vector<std::thread> threads;
+   threads.reserve( thread_num - 1 );
+   for (int t = 1; t < thread_num; ++t) {
+      const int begin = t * tasks_per_thread;
+      const int end = std::min( begin + tasks_per_thread, task_num );
+      if (begin < end) threads.emplace_back( task, begin, end );
+   }
+   task( 0, tasks_per_thread );
+   for (auto& thread : threads) thread.join();
+}
+
+template<typename T>
+void SummedAreaTable::buildTable(T* moments, int size) const
+{
+   const int row_length = size * 2;
+
+   // the rows are independent, so each thread scans its own band of them.
+   runInParallel(
+      size, [moments, size, row_length](int begin, int end) {
+         for (int y = begin; y < end; ++y) scanRow( moments + static_cast<size_t>(y) * row_length, size );
+      }
+   );
+
+   // then each block of the columns is carried down to the bottom before the next one,
+   // so the previous row of the block is still in the cache.
+   const int block_num = (row_length + ColumnBlockWidth - 1) / ColumnBlockWidth;
+   runInParallel(
+      block_num, [moments, size, row_length](int begin, int end) {
+         for (int b = begin; b < end; ++b) {
+            const int x = b * ColumnBlockWidth;
+            const int count = std::min( ColumnBlockWidth, row_length - x );
+            for (int y = 1; y < size; ++y) {
+               T* row = moments + static_cast<size_t>(y) * row_length + x;
+               addRow( row, row - row_length, count );
+            }
+         }
+      }
+   );
+}
+
+void SummedAreaTable::build(std::vector<float>& moments, int size) const
+{
+   buildTable( moments.data(), size );
+}
+
+void SummedAreaTable::build(std::vector<uint32_t>& moments, int size) const
+{
+   buildTable( moments.data(), size );
+}
+
+std::string SummedAreaTable::getInstructionSetName()
+{
+   if (isAVX2Supported()) return "AVX2";
+#ifdef SAT_USE_SSE
+   return "SSE2";
+#else
+   return "Scalar";
+#endif
+}
+
+glm::vec2 SummedAreaTable::getMean(const std::vector<float>& moments)
+{
+   glm::dvec2 sum(0.0);
+   for (size_t i = 0; i < moments.size(); i += 2) {
+      sum.x += static_cast<double>(moments[i]);
+      sum.y += static_cast<double>(moments[i + 1]);
+   }
+   return glm::vec2(sum / static_cast<double>(std::max( moments.size() / 2, size_t(1) )));
+}
+
+std::vector<uint32_t> SummedAreaTable::getFixedPointMoments(
+   const std::vector<float>& moments,
+   const glm::vec2& mean,
+   int fraction_bits
+)
+{
+   // it follows the row pass of sat_generator.comp operation by operation, so the tables match bit by bit.
+   const auto scale = static_cast<float>(1 << fraction_bits);
+   std::vector<uint32_t> fixed_point_moments(moments.size());
+   for (size_t i = 0; i < moments.size(); ++i) {
+      const float deviation = moments[i] - mean[static_cast<int>(i & 1)];
+      fixed_point_moments[i] = static_cast<uint32_t>(static_cast<int32_t>(std::nearbyint( deviation * scale )));
+   }
+   return fixed_point_moments;
+}
+
+std::vector<double> SummedAreaTable::getReferenceTable(const std::vector<float>& moments, int size)
+{
+   const auto row_length = static_cast<size_t>(size) * 2;
+   std::vector<double> table(moments.begin(), moments.end());
+   for (size_t y = 0; y < static_cast<size_t>(size); ++y) {
+      double* row = table.data() + y * row_length;
+      for (size_t i = 2; i < row_length; ++i) row[i] += row[i - 2];
+   }
+   for (size_t y = 1; y < static_cast<size_t>(size); ++y) {
+      double* row = table.data() + y * row_length;
+      const double* previous_row = row - row_length;
+      for (size_t i = 0; i < row_length; ++i) row[i] += previous_row[i];
+   }
+   return table;
+}
+
+double SummedAreaTable::getMaxAreaError(
+   const std::vector<double>& reference,
+   int size,
+   int max_filter_size,
+   int min_filter_size,
+   const std::function<glm::dvec2(int, int, int, int)>& get_area_sum
+)
+{
+   // the tiles cover (x0, x1] x (y0, y1] like the lookups of the scene shader,
+   // and the corners at -1 read zero like the border of the texture.
+   const auto get_reference_sum = [&reference, size](int x, int y) {
+      if (x < 0 || y < 0) return glm::dvec2(0.0);
+      const size_t index = (static_cast<size_t>(y) * size + x) * 2;
+      return glm::dvec2(reference[index], reference[index + 1]);
+   };
+
+   std::mt19937 generator( 7 );
+   const int filter_size_limit = std::min( max_filter_size, size );
+   std::uniform_int_distribution<int> filter_size_distribution(
+      std::min( min_filter_size, filter_size_limit ), filter_size_limit
+   );
+   double max_error = 0.0;
+   for (int i = 0; i < AreaQueryNum; ++i) {
+      const int width = filter_size_distribution( generator );
+      const int height = filter_size_distribution( generator );
+      const int x0 = std::uniform_int_distribution<int>( -1, size - 1 - width )( generator );
+      const int y0 = std::uniform_int_distribution<int>( -1, size - 1 - height )( generator );
+      const int x1 = x0 + width;
+      const int y1 = y0 + height;
+      const glm::dvec2 expected = get_reference_sum( x1, y1 ) - get_reference_sum( x0, y1 ) -
+         get_reference_sum( x1, y0 ) + get_reference_sum( x0, y0 );
+      const glm::dvec2 error = glm::abs( get_area_sum( x0, y0, x1, y1 ) - expected );
+
+      // the error is measured on the mean moments of the tile, which is what the chebyshev bound sees.
+      max_error = std::max( max_error, std::max( error.x, error.y ) / static_cast<double>(width * height) );
+   }
+   return max_error;
+}
+
+double SummedAreaTable::getMaxAreaError(
+   const std::vector<float>& table,
+   const std::vector<double>& reference,
+   int size,
+   int max_filter_size,
+   int min_filter_size
+)
+{
+   const auto get_sum = [&table, size](int x, int y) {
+      if (x < 0 || y < 0) return glm::vec2(0.0f);
+      const size_t index = (static_cast<size_t>(y) * size + x) * 2;
+      return glm::vec2(table[index], table[index + 1]);
+   };
+   return getMaxAreaError(
+      reference, size, max_filter_size, min_filter_size, [&get_sum](int x0, int y0, int x1, int y1) {
+         return glm::dvec2(get_sum( x1, y1 ) - get_sum( x0, y1 ) - get_sum( x1, y0 ) + get_sum( x0, y0 ));
+      }
+   );
+}
+
+double SummedAreaTable::getMaxAreaError(
+   const std::vector<uint32_t>& table,
+   const std::vector<double>& reference,
+   int size,
+   int max_filter_size,
+   const glm::vec2& mean,
+   int fraction_bits,
+   int min_filter_size
+)
+{
+   const auto get_sum = [&table, size](int x, int y) {
+      if (x < 0 || y < 0) return glm::uvec2(0u);
+      const size_t index = (static_cast<size_t>(y) * size + x) * 2;
+      return glm::uvec2(table[index], table[index + 1]);
+   };
+   const double scale = static_cast<double>(1 << fraction_bits);
+   return getMaxAreaError(
+      reference, size, max_filter_size, min_filter_size, [&get_sum, &mean, scale](int x0, int y0, int x1, int y1) {
+         const glm::uvec2 sum = get_sum( x1, y1 ) - get_sum( x0, y1 ) - get_sum( x1, y0 ) + get_sum( x0, y0 );
+         const auto area = static_cast<double>((x1 - x0) * (y1 - y0));
+         return glm::dvec2(glm::ivec2(sum)) / scale + glm::dvec2(mean) * area;
+      }
+   );
+}
+
+double SummedAreaTable::getFloatErrorBound(int size, int filter_size)
+{
+   // the moments are at most one, so no sum exceeds size^2. the rounding errors of the 2 * size additions behind
+   // a corner grow like a random walk, so a corner stays within 8 * sqrt(2 * size) half ulps of that largest sum,
+   // and the four corners of a tile add up before the division by its area.
+   const double largest_sum = static_cast<double>(size) * static_cast<double>(size);
+   const double corner_error = 8.0 * std::sqrt( 2.0 * static_cast<double>(size) ) * std::ldexp( largest_sum, -24 );
+   return 4.0 * corner_error / (static_cast<double>(filter_size) * static_cast<double>(filter_size));
+}
+
+bool SummedAreaTable::validate()
+{
+   // the odd size leaves the tails of the rows and the column blocks to the scalar code.
+   constexpr int fraction_bits = 15;
+   constexpr int max_filter_size = 256;
+   const SummedAreaTable multi_threaded;
+   const SummedAreaTable single_threaded( 1 );
+   bool passed = true;
+   std::cout << "======================= Summed Area Table Validation =======================\n";
+   std::cout << ">> " << getInstructionSetName() << ", " << multi_threaded.getThreadNum() << " threads\n";
+   for (const int size : { 1027, 4096 }) {
+      std::vector<float> moments(static_cast<size_t>(size) * size * 2);
+      fillMoments<float>( moments, size, [](float value) { return value; } );
+      const std::vector<double> reference = getReferenceTable( moments, size );
+
+      std::vector<float> float_table = moments;
+      std::vector<float> single_threaded_float_table = moments;
+      multi_threaded.build( float_table, size );
+      single_threaded.build( single_threaded_float_table, size );
+
+      const glm::vec2 mean = getMean( moments );
+      std::vector<uint32_t> fixed_point_table = getFixedPointMoments( moments, mean, fraction_bits );
+      std::vector<uint32_t> single_threaded_fixed_point_table = fixed_point_table;
+      multi_threaded.build( fixed_point_table, size );
+      single_threaded.build( single_threaded_fixed_point_table, size );
+
+      // the threads never change the order of the additions, so their tables should be identical.
+      const double float_error = getMaxAreaError( float_table, reference, size, max_filter_size );
+      const double float_filter_error =
+         getMaxAreaError( float_table, reference, size, max_filter_size, max_filter_size );
+      const double float_error_bound = getFloatErrorBound( size, max_filter_size );
+      const double fixed_point_error =
+         getMaxAreaError( fixed_point_table, reference, size, max_filter_size, mean, fraction_bits );
+      const bool is_deterministic = float_table == single_threaded_float_table &&
+         fixed_point_table == single_threaded_fixed_point_table;
+      const bool is_exact = fixed_point_error <= 1.0 / static_cast<double>(1 << fraction_bits);
+      const bool is_accurate = float_filter_error <= float_error_bound;
+      passed = passed && is_deterministic && is_exact && is_accurate;
+
+      std::cout << ">> " << size << "x" << size << ": RG32F error " << float_error << " (";
+      std::cout << float_filter_error << " at " << max_filter_size << "x" << max_filter_size << ", bound ";
+      std::cout << float_error_bound << (is_accurate ? ")" : ", FAILED)");
+      std::cout << ", RG32UI error " << fixed_point_error;
+      std::cout << (is_deterministic ? ", deterministic" : ", NOT deterministic");
+      std::cout << (is_exact ? "\n" : " (FAILED)\n");
+   }
+   std::cout << "============================================================================\n";
+   return passed;
+}
+
+void SummedAreaTable::benchmark(int max_size)
+{
+   const SummedAreaTable builder;
+   std::cout << "======================= Summed Area Table Benchmark ========================\n";
+   std::cout << ">> " << getInstructionSetName() << ", " << builder.getThreadNum() << " threads\n";
+   for (int size = 1024; size <= max_size; size *= 2) {
+      // the smaller tables are built several times, so every size runs for about the same time.
+      const int iteration_num = std::max( 1, 16384 / size * (16384 / size) / 4 );
+      const auto texel_num = static_cast<double>(size) * static_cast<double>(size);
+      std::cout << ">> " << size << "x" << size << ":";
+      {
+         std::vector<float> moments(static_cast<size_t>(size) * size * 2);
+         double elapsed_time = 0.0;
+         for (int i = 0; i < iteration_num; ++i) {
+            fillMoments<float>( moments, size, [](float value) { return value; } );
+            const auto start = std::chrono::steady_clock::now();
+            builder.build( moments, size );
+            const auto end = std::chrono::steady_clock::now();
+            elapsed_time += std::chrono::duration<double, std::milli>(end - start).count();
+         }
+         elapsed_time /= static_cast<double>(iteration_num);
+         std::cout << std::fixed << std::setprecision( 2 ) << " RG32F " << elapsed_time << " ms (";
+         std::cout << texel_num / (elapsed_time * 1e+3) << " Mtexels/s),";
+      }
+      {
+         std::vector<uint32_t> moments(static_cast<size_t>(size) * size * 2);
+         double elapsed_time = 0.0;
+         for (int i = 0; i < iteration_num; ++i) {
+            fillMoments<uint32_t>(
+               moments, size, [](float value) { return static_cast<uint32_t>(std::nearbyint( value * 32768.0f )); }
+            );
+            const auto start = std::chrono::steady_clock::now();
+            builder.build( moments, size );
+            const auto end = std::chrono::steady_clock::now();
+            elapsed_time += std::chrono::duration<double, std::milli>(end - start).count();
+         }
+         elapsed_time /= static_cast<double>(iteration_num);
+         std::cout << " RG32UI " << elapsed_time << " ms (" << texel_num / (elapsed_time * 1e+3) << " Mtexels/s)\n";
+      }
+   }
+   std::cout << "============================================================================\n";
+}
\ No newline at end of file
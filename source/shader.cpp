@@ -1,11 +1,14 @@
 #include "shader.h"
 
-ShaderGL::ShaderGL() : ShaderProgram( 0 )
+ShaderGL::ShaderGL(DefineSet defines) :
+   ShaderProgram( 0 ), PendingKey( 0 ), Locations{}, Defines( std::move( defines ) )
 {
+   Locations.fill( -1 );
 }
 
 ShaderGL::~ShaderGL()
 {
+   for (const auto& shader : PendingShaders) glDeleteShader( shader );
    if (ShaderProgram != 0) glDeleteProgram( ShaderProgram );
 }
 
@@ -17,10 +20,22 @@ void ShaderGL::readShaderFile(std::string& shader_contents, const char* shader_p
       return;
    }
 
+   // an #include line is replaced with the file it names relative to this one, and #line keeps the line numbers.
+   const std::string include_directive = "#include \"";
    std::string line;
+   int line_number = 0;
    while (!file.eof()) {
       getline( file, line );
-      shader_contents.append( line + "\n" );
+      line_number++;
+      if (line.compare( 0, include_directive.size(), include_directive ) == 0) {
+         const size_t name_begin = include_directive.size();
+         const std::string include_name = line.substr( name_begin, line.find( '"', name_begin ) - name_begin );
+         const std::string include_path = (std::filesystem::path(shader_path).parent_path() / include_name).string();
+         shader_contents.append( "#line 1\n" );
+         readShaderFile( shader_contents, include_path.c_str() );
+         shader_contents.append( "#line " + std::to_string( line_number + 1 ) + "\n" );
+      }
+      else shader_contents.append( line + "\n" );
    }
    file.close();
 }
@@ -52,133 +67,337 @@ bool ShaderGL::checkCompileError(GLenum shader_type, const GLuint& shader)
       glGetShaderInfoLog( shader, max_length, &max_length, &error_log[0] );
       for (const auto& c : error_log) std::cerr << c;
       std::cerr << "\n";
-      glDeleteShader( shader );
    }
    return compiled == GL_TRUE;
 }
 
-GLuint ShaderGL::getCompiledShader(GLenum shader_type, const char* shader_path)
+bool ShaderGL::checkLinkError() const
 {
-   if (shader_path == nullptr) return 0;
+   GLint linked = 0;
+   glGetProgramiv( ShaderProgram, GL_LINK_STATUS, &linked );
+
+   if (linked == GL_FALSE) {
+      GLint max_length = 0;
+      glGetProgramiv( ShaderProgram, GL_INFO_LOG_LENGTH, &max_length );
+
+      std::cerr << " ======= Program log ======= \n";
+      std::vector<GLchar> error_log(std::max( max_length, 1 ));
+      glGetProgramInfoLog( ShaderProgram, max_length, &max_length, &error_log[0] );
+      for (const auto& c : error_log) std::cerr << c;
+      std::cerr << "\n";
+   }
+   return linked == GL_TRUE;
+}
+
+std::string ShaderGL::getFloatLiteral(float value)
+{
+   // the shortest digits that give back the same float, written as a float literal even for a whole number.
+   std::string literal;
+   for (int precision = 6; precision <= std::numeric_limits<float>::max_digits10; ++precision) {
+      std::ostringstream stream;
+      stream << std::setprecision( precision ) << value;
+      literal = stream.str();
+      if (std::stof( literal ) == value) break;
+   }
+   if (literal.find_first_of( ".e" ) == std::string::npos) literal += ".0";
+   return literal + "f";
+}
+
+std::string ShaderGL::getDefineBlock() const
+{
+   std::string block;
+   for (const auto& define : Defines) {
+      block += "#define " + define.first;
+      if (!define.second.empty()) block += " " + define.second;
+      block += "\n";
+   }
+   return block;
+}
+
+void ShaderGL::addShaderSource(ShaderSources& sources, GLenum shader_type, const char* shader_path) const
+{
+   if (shader_path == nullptr) return;
 
    std::string shader_contents;
    readShaderFile( shader_contents, shader_path );
 
+   // the defines should follow the #version line, and #line keeps the line numbers of the compile log unchanged.
+   if (!Defines.empty()) shader_contents.insert( shader_contents.find( '\n' ) + 1, getDefineBlock() + "#line 2\n" );
+   sources.emplace_back( shader_type, std::move( shader_contents ) );
+}
+
+GLuint ShaderGL::getSubmittedShader(GLenum shader_type, const std::string& shader_source)
+{
+   // the compile status is not queried here, so the driver is free to keep compiling while the next one is submitted.
    const GLuint shader = glCreateShader( shader_type );
-   const char* shader_source = shader_contents.c_str();
-   glShaderSource( shader, 1, &shader_source, nullptr );
+   const char* source = shader_source.c_str();
+   glShaderSource( shader, 1, &source, nullptr );
    glCompileShader( shader );
-   if (!checkCompileError( shader_type, shader )) {
-      std::cerr << "Could not compile shader\n";
-      return 0;
-   }
    return shader;
 }
 
-void ShaderGL::setShader(
-   const char* vertex_shader_path,
-   const char* fragment_shader_path,
-   const char* geometry_shader_path,
-   const char* tessellation_control_shader_path,
-   const char* tessellation_evaluation_shader_path
-)
+uint64_t ShaderGL::getProgramKey(const ShaderSources& sources)
 {
-   const GLuint vertex_shader = getCompiledShader( GL_VERTEX_SHADER, vertex_shader_path );
-   const GLuint fragment_shader = getCompiledShader( GL_FRAGMENT_SHADER, fragment_shader_path );
-   const GLuint geometry_shader = getCompiledShader( GL_GEOMETRY_SHADER, geometry_shader_path );
-   const GLuint tessellation_control_shader = getCompiledShader( GL_TESS_CONTROL_SHADER, tessellation_control_shader_path );
-   const GLuint tessellation_evaluation_shader = getCompiledShader( GL_TESS_EVALUATION_SHADER, tessellation_evaluation_shader_path );
-   ShaderProgram = glCreateProgram();
-   glAttachShader( ShaderProgram, vertex_shader );
-   glAttachShader( ShaderProgram, fragment_shader );
-   if (geometry_shader != 0) glAttachShader( ShaderProgram, geometry_shader );
-   if (tessellation_control_shader != 0) glAttachShader( ShaderProgram, tessellation_control_shader );
-   if (tessellation_evaluation_shader != 0) glAttachShader( ShaderProgram, tessellation_evaluation_shader );
-   glLinkProgram( ShaderProgram );
-   glDeleteShader( vertex_shader );
-   glDeleteShader( fragment_shader );
-   if (geometry_shader != 0) glDeleteShader( geometry_shader );
-   if (tessellation_control_shader != 0) glDeleteShader( tessellation_control_shader );
-   if (tessellation_evaluation_shader != 0) glDeleteShader( tessellation_evaluation_shader );
+   // the binary formats belong to the driver, so the strings naming it are hashed along with the sources.
+   // the 64-bit FNV-1a hash stays the same across runs, unlike std::hash.
+   uint64_t key = 14695981039346656037ull;
+   const auto hash = [&key](const std::string& text) {
+      for (const auto& c : text) {
+         key ^= static_cast<uint8_t>(c);
+         key *= 1099511628211ull;
+      }
+   };
+   for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+      const auto* driver_string = reinterpret_cast<const char*>(glGetString( name ));
+      hash( driver_string != nullptr ? std::string(driver_string) + "\n" : "\n" );
+   }
+   for (const auto& source : sources) hash( std::to_string( source.first ) + "\n" + source.second );
+   return key;
 }
 
-void ShaderGL::setComputeShader(const char* compute_shader_path)
+std::string ShaderGL::getProgramCachePath(uint64_t key)
 {
-   const GLuint compute_shader = getCompiledShader( GL_COMPUTE_SHADER, compute_shader_path );
-   ShaderProgram = glCreateProgram();
-   glAttachShader( ShaderProgram, compute_shader );
-   glLinkProgram( ShaderProgram );
-   glDeleteShader( compute_shader );
+   std::stringstream path;
+   path << CMAKE_BINARY_DIR << "/shader_cache/" << std::hex << std::setw( 16 ) << std::setfill( '0' ) << key << ".bin";
+   return path.str();
 }
 
-void ShaderGL::setBasicTransformationUniforms()
+bool ShaderGL::loadProgramBinary(const std::string& cache_path, uint64_t key) const
 {
-   Location.World = glGetUniformLocation( ShaderProgram, "WorldMatrix" );
-   Location.View = glGetUniformLocation( ShaderProgram, "ViewMatrix" );
-   Location.Projection = glGetUniformLocation( ShaderProgram, "ProjectionMatrix" );
-   Location.ModelViewProjection = glGetUniformLocation( ShaderProgram, "ModelViewProjectionMatrix" );
+   std::ifstream file( cache_path, std::ios::in | std::ios::binary );
+   if (!file.is_open()) return false;
+
+   ProgramBinaryHeader header{};
+   file.read( reinterpret_cast<char*>(&header), sizeof( header ) );
+   if (!file || header.Key != key || header.Length <= 0) return false;
+
+   std::vector<char> binary(header.Length);
+   file.read( binary.data(), header.Length );
+   if (!file) return false;
+
+   // the driver rejects the binary when it has been updated since, and then the program is built from the sources.
+   glProgramBinary( ShaderProgram, header.Format, binary.data(), header.Length );
+   GLint linked = 0;
+   glGetProgramiv( ShaderProgram, GL_LINK_STATUS, &linked );
+   return linked == GL_TRUE;
 }
 
-void ShaderGL::setTextUniformLocations()
+void ShaderGL::saveProgramBinary(const std::string& cache_path, uint64_t key) const
 {
-   setBasicTransformationUniforms();
-   addUniformLocation( "TextScale" );
-   Location.Texture[0] = glGetUniformLocation( ShaderProgram, "BaseTexture" );
+   GLint binary_format_num = 0;
+   glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_num );
+   if (binary_format_num == 0) return;
+
+   ProgramBinaryHeader header{};
+   header.Key = key;
+   glGetProgramiv( ShaderProgram, GL_PROGRAM_BINARY_LENGTH, &header.Length );
+   if (header.Length <= 0) return;
+
+   std::vector<char> binary(header.Length);
+   glGetProgramBinary( ShaderProgram, header.Length, &header.Length, &header.Format, binary.data() );
+
+   std::error_code error;
+   std::filesystem::create_directories( std::filesystem::path(cache_path).parent_path(), error );
+   std::ofstream file( cache_path, std::ios::out | std::ios::binary | std::ios::trunc );
+   if (!file.is_open()) return;
+
+   file.write( reinterpret_cast<const char*>(&header), sizeof( header ) );
+   file.write( binary.data(), header.Length );
 }
 
-void ShaderGL::setLightViewUniformLocations()
+void ShaderGL::setProgram(const ShaderSources& sources)
 {
-   setBasicTransformationUniforms();
+   // the program is loaded from the binary cached in a previous launch when the sources and the driver match,
+   // so only the programs which have changed since are compiled.
+   const uint64_t key = getProgramKey( sources );
+   const std::string cache_path = getProgramCachePath( key );
+   ShaderProgram = glCreateProgram();
+   if (loadProgramBinary( cache_path, key )) {
+      setUniformLocations();
+      return;
+   }
+
+   // the compiles and the link are only submitted, and finish() collects their results once they complete.
+   PendingKey = key;
+   PendingSources = sources;
+   for (const auto& source : sources) {
+      const GLuint shader = getSubmittedShader( source.first, source.second );
+      glAttachShader( ShaderProgram, shader );
+      PendingShaders.emplace_back( shader );
+   }
+   glProgramParameteri( ShaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+   glLinkProgram( ShaderProgram );
 }
 
-void ShaderGL::setLightViewArrayUniformLocations()
+void ShaderGL::enableParallelCompile()
 {
-   setBasicTransformationUniforms();
-   addUniformLocation( "TextureIndex" );
-   addUniformLocation( "LightViewProjectionMatrix" );
+   GLint extension_num = 0;
+   glGetIntegerv( GL_NUM_EXTENSIONS, &extension_num );
+   std::string extension_name;
+   for (int i = 0; i < extension_num && extension_name.empty(); ++i) {
+      const auto* extension = reinterpret_cast<const char*>(glGetStringi( GL_EXTENSIONS, i ));
+      if (std::strcmp( extension, "GL_KHR_parallel_shader_compile" ) == 0) extension_name = "KHR";
+      else if (std::strcmp( extension, "GL_ARB_parallel_shader_compile" ) == 0) extension_name = "ARB";
+   }
+   if (extension_name.empty()) return;
+
+   // the core profile header does not have the entry point either, so it is loaded here.
+   // without the extension, the compiles are still submitted up front but finish() blocks on each program.
+   using MaxShaderCompilerThreads = void (APIENTRY*)(GLuint);
+   const auto max_shader_compiler_threads = reinterpret_cast<MaxShaderCompilerThreads>(
+      glfwGetProcAddress( std::string("glMaxShaderCompilerThreads" + extension_name).c_str() )
+   );
+   if (max_shader_compiler_threads == nullptr) return;
+
+   // 0xFFFFFFFF lets the driver decide how many threads the compiles run on.
+   max_shader_compiler_threads( 0xFFFFFFFF );
+   ParallelCompileSupported = true;
 }
 
-void ShaderGL::setSATUniformLocations()
+bool ShaderGL::isReady() const
 {
-   addUniformLocation( "Size" );
-   addUniformLocation( "Offsets" );
+   if (PendingShaders.empty() || !ParallelCompileSupported) return true;
+
+   GLint completed = GL_FALSE;
+   glGetProgramiv( ShaderProgram, CompletionStatus, &completed );
+   return completed == GL_TRUE;
 }
 
-void ShaderGL::setSceneUniformLocations(int light_num)
+void ShaderGL::finish()
 {
-   setBasicTransformationUniforms();
-
-   Location.MaterialEmission = glGetUniformLocation( ShaderProgram, "Material.EmissionColor" );
-   Location.MaterialAmbient = glGetUniformLocation( ShaderProgram, "Material.AmbientColor" );
-   Location.MaterialDiffuse = glGetUniformLocation( ShaderProgram, "Material.DiffuseColor" );
-   Location.MaterialSpecular = glGetUniformLocation( ShaderProgram, "Material.SpecularColor" );
-   Location.MaterialSpecularExponent = glGetUniformLocation( ShaderProgram, "Material.SpecularExponent" );
+   if (PendingShaders.empty()) return;
 
-   Location.UseLight = glGetUniformLocation( ShaderProgram, "UseLight" );
-   Location.LightNum = glGetUniformLocation( ShaderProgram, "LightNum" );
-   Location.GlobalAmbient = glGetUniformLocation( ShaderProgram, "GlobalAmbient" );
+   bool compiled = true;
+   for (size_t i = 0; i < PendingShaders.size(); ++i) {
+      if (!checkCompileError( PendingSources[i].first, PendingShaders[i] )) {
+         std::cerr << "Could not compile shader\n";
+         compiled = false;
+      }
+      glDeleteShader( PendingShaders[i] );
+   }
+   if (checkLinkError()) {
+      setUniformLocations();
+      if (compiled) saveProgramBinary( getProgramCachePath( PendingKey ), PendingKey );
+   }
+   PendingShaders.clear();
+   PendingSources.clear();
+}
 
-   Location.Lights.resize( light_num );
-   for (int i = 0; i < light_num; ++i) {
-      Location.Lights[i].LightSwitch = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].LightSwitch").c_str() );
-      Location.Lights[i].LightPosition = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].Position").c_str() );
-      Location.Lights[i].LightAmbient = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].AmbientColor").c_str() );
-      Location.Lights[i].LightDiffuse = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].DiffuseColor").c_str() );
-      Location.Lights[i].LightSpecular = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpecularColor").c_str() );
-      Location.Lights[i].SpotlightDirection = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpotlightDirection").c_str() );
-      Location.Lights[i].SpotlightCutoffAngle = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpotlightCutoffAngle").c_str() );
-      Location.Lights[i].SpotlightFeather = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpotlightFeather").c_str() );
-      Location.Lights[i].LightFallOffRadius = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].FallOffRadius").c_str() );
+void ShaderGL::finishAll(const std::vector<ShaderGL*>& shaders)
+{
+   // the programs are collected in the order they complete, so none of them waits behind a slower one.
+   std::vector<ShaderGL*> pending = shaders;
+   while (!pending.empty()) {
+      const auto ready = std::stable_partition(
+         pending.begin(), pending.end(), [](const ShaderGL* shader) { return !shader->isReady(); }
+      );
+      for (auto it = ready; it != pending.end(); ++it) (*it)->finish();
+      pending.erase( ready, pending.end() );
+      if (!pending.empty()) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
    }
+}
 
-   addUniformLocation( "LightIndex" );
-   addUniformLocation( "LightViewProjectionMatrix" );
+void ShaderGL::setShader(
+   const char* vertex_shader_path,
+   const char* fragment_shader_path,
+   const char* geometry_shader_path,
+   const char* tessellation_control_shader_path,
+   const char* tessellation_evaluation_shader_path
+)
+{
+   ShaderSources sources;
+   addShaderSource( sources, GL_VERTEX_SHADER, vertex_shader_path );
+   addShaderSource( sources, GL_FRAGMENT_SHADER, fragment_shader_path );
+   addShaderSource( sources, GL_GEOMETRY_SHADER, geometry_shader_path );
+   addShaderSource( sources, GL_TESS_CONTROL_SHADER, tessellation_control_shader_path );
+   addShaderSource( sources, GL_TESS_EVALUATION_SHADER, tessellation_evaluation_shader_path );
+   setProgram( sources );
+}
+
+void ShaderGL::setComputeShader(const char* compute_shader_path)
+{
+   ShaderSources sources;
+   addShaderSource( sources, GL_COMPUTE_SHADER, compute_shader_path );
+   setProgram( sources );
 }
 
-void ShaderGL::setPSSMSceneUniformLocations(int light_num)
+const std::unordered_map<std::string, ShaderGL::UNIFORM>& ShaderGL::getUniformHandles()
 {
-   setSceneUniformLocations( light_num );
-   addUniformLocation( "SplitPositions" );
+   // the names as the programs list them, where the members of a struct are qualified by the struct.
+   static const std::unordered_map<std::string, UNIFORM> handles = {
+      { "WorldMatrix", UNIFORM::WorldMatrix },
+      { "ViewMatrix", UNIFORM::ViewMatrix },
+      { "ProjectionMatrix", UNIFORM::ProjectionMatrix },
+      { "ModelViewProjectionMatrix", UNIFORM::ModelViewProjectionMatrix },
+      { "InverseViewMatrix", UNIFORM::InverseViewMatrix },
+      { "InverseProjectionMatrix", UNIFORM::InverseProjectionMatrix },
+      { "LightViewProjectionMatrix", UNIFORM::LightViewProjectionMatrix },
+      { "ShadowedLightMatrices", UNIFORM::ShadowedLightMatrices },
+      { "ShadowedLightFarPlanes", UNIFORM::ShadowedLightFarPlanes },
+      { "Material.EmissionColor", UNIFORM::MaterialEmissionColor },
+      { "Material.AmbientColor", UNIFORM::MaterialAmbientColor },
+      { "Material.DiffuseColor", UNIFORM::MaterialDiffuseColor },
+      { "Material.SpecularColor", UNIFORM::MaterialSpecularColor },
+      { "Material.SpecularExponent", UNIFORM::MaterialSpecularExponent },
+      { "MaterialID", UNIFORM::MaterialID },
+      { "TextScale", UNIFORM::TextScale },
+      { "TextureIndex", UNIFORM::TextureIndex },
+      { "SplitMask", UNIFORM::SplitMask },
+      { "SplitPositions", UNIFORM::SplitPositions },
+      { "AtlasTiles", UNIFORM::AtlasTiles },
+      { "ShadowTiles", UNIFORM::ShadowTiles },
+      { "Exponents", UNIFORM::Exponents },
+      { "FaceMask", UNIFORM::FaceMask },
+      { "LightPosition", UNIFORM::LightPosition },
+      { "LightFarPlane", UNIFORM::LightFarPlane },
+      { "LightIndex", UNIFORM::LightIndex },
+      { "LightNum", UNIFORM::LightNum },
+      { "MinVariance", UNIFORM::MinVariance },
+      { "MaxFilterSize", UNIFORM::MaxFilterSize },
+      { "Size", UNIFORM::Size },
+      { "Direction", UNIFORM::Direction },
+      { "MeanLevel", UNIFORM::MeanLevel },
+      { "FixedPointScale", UNIFORM::FixedPointScale },
+      { "Radius", UNIFORM::Radius },
+      { "Weights", UNIFORM::Weights },
+      { "ClusterGridSize", UNIFORM::ClusterGridSize },
+      { "ClusterDepthRange", UNIFORM::ClusterDepthRange },
+      { "ClusterTileSize", UNIFORM::ClusterTileSize },
+      { "UseSAT", UNIFORM::UseSAT },
+      { "UseIntegerSAT", UNIFORM::UseIntegerSAT },
+      { "UseTextureGather", UNIFORM::UseTextureGather },
+      { "UseNegativeMoments", UNIFORM::UseNegativeMoments }
+   };
+   return handles;
+}
+
+void ShaderGL::setUniformLocations()
+{
+   // the active uniforms of the linked program are listed once, and the handles missing from it stay at -1,
+   // which the gl calls ignore.
+   Locations.fill( -1 );
+   GLint uniform_num = 0, max_name_length = 0;
+   glGetProgramInterfaceiv( ShaderProgram, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniform_num );
+   glGetProgramInterfaceiv( ShaderProgram, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_name_length );
+
+   const auto& handles = getUniformHandles();
+   std::vector<GLchar> name(std::max( max_name_length, 1 ));
+   for (GLint i = 0; i < uniform_num; ++i) {
+      // the members of the uniform blocks have no locations.
+      constexpr GLenum property = GL_LOCATION;
+      GLint location = -1;
+      glGetProgramResourceiv( ShaderProgram, GL_UNIFORM, i, 1, &property, 1, nullptr, &location );
+      if (location < 0) continue;
+
+      // an array is listed by its first element, whose location is also that of the array.
+      glGetProgramResourceName( ShaderProgram, GL_UNIFORM, i, max_name_length, nullptr, name.data() );
+      std::string uniform_name(name.data());
+      const size_t subscript = uniform_name.rfind( "[0]" );
+      if (subscript != std::string::npos && subscript + 3 == uniform_name.size()) uniform_name.resize( subscript );
+
+      const auto handle = handles.find( uniform_name );
+      if (handle != handles.end()) Locations[static_cast<size_t>(handle->second)] = location;
+   }
 }
 
 void ShaderGL::transferBasicTransformationUniforms(const glm::mat4& to_world, const CameraGL* camera) const
@@ -186,12 +405,8 @@ void ShaderGL::transferBasicTransformationUniforms(const glm::mat4& to_world, co
    const glm::mat4 view = camera->getViewMatrix();
    const glm::mat4 projection = camera->getProjectionMatrix();
    const glm::mat4 model_view_projection = projection * view * to_world;
-   glUniformMatrix4fv( Location.World, 1, GL_FALSE, &to_world[0][0] );
-   glUniformMatrix4fv( Location.View, 1, GL_FALSE, &view[0][0] );
-   glUniformMatrix4fv( Location.Projection, 1, GL_FALSE, &projection[0][0] );
-   glUniformMatrix4fv( Location.ModelViewProjection, 1, GL_FALSE, &model_view_projection[0][0] );
-
-   for (const auto& texture : Location.Texture) {
-      glUniform1i( texture.second, texture.first );
-   }
+   glUniformMatrix4fv( getLocation( UNIFORM::WorldMatrix ), 1, GL_FALSE, &to_world[0][0] );
+   glUniformMatrix4fv( getLocation( UNIFORM::ViewMatrix ), 1, GL_FALSE, &view[0][0] );
+   glUniformMatrix4fv( getLocation( UNIFORM::ProjectionMatrix ), 1, GL_FALSE, &projection[0][0] );
+   glUniformMatrix4fv( getLocation( UNIFORM::ModelViewProjectionMatrix ), 1, GL_FALSE, &model_view_projection[0][0] );
 }
\ No newline at end of file
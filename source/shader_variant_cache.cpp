@@ -0,0 +1,36 @@
+#include "shader_variant_cache.h"
+
+std::string ShaderVariantCacheGL::getVariantKey(
+   const ShaderGL::DefineSet& defines,
+   const std::string& vertex_shader_path,
+   const std::string& fragment_shader_path,
+   const std::string& geometry_shader_path
+)
+{
+   // the paths and the defines cannot contain a line break, so the key is never shared by two variants.
+   std::string key = vertex_shader_path + "\n" + fragment_shader_path + "\n" + geometry_shader_path + "\n";
+   for (const auto& define : defines) key += define.first + " " + define.second + "\n";
+   return key;
+}
+
+ShaderGL* ShaderVariantCacheGL::getShader(
+   const ShaderGL::DefineSet& defines,
+   const std::string& vertex_shader_path,
+   const std::string& fragment_shader_path,
+   const std::string& geometry_shader_path
+)
+{
+   const std::string key = getVariantKey( defines, vertex_shader_path, fragment_shader_path, geometry_shader_path );
+   const auto variant = Variants.find( key );
+   if (variant != Variants.end()) return variant->second.get();
+
+   auto shader = std::make_unique<ShaderGL>( defines );
+   shader->setShader(
+      vertex_shader_path.c_str(),
+      fragment_shader_path.c_str(),
+      geometry_shader_path.empty() ? nullptr : geometry_shader_path.c_str()
+   );
+   ShaderGL* built = shader.get();
+   Variants.emplace( key, std::move( shader ) );
+   return built;
+}
\ No newline at end of file
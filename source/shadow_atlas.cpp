@@ -0,0 +1,147 @@
+#include "shadow_atlas.h"
+
+ShadowAtlas::ShadowAtlas(int atlas_size, int min_tile_size) :
+   AtlasSize( atlas_size ), MinTileSize( min_tile_size ), FrameIndex( 0 )
+{
+   // the level 0 is the whole atlas, and each level below splits the tiles into four.
+   FreeTiles.resize( getLevel( MinTileSize ) + 1 );
+   FreeTiles[0].emplace_back( 0, 0 );
+}
+
+int ShadowAtlas::getLevel(int tile_size) const
+{
+   int level = 0;
+   while ((AtlasSize >> (level + 1)) >= tile_size) level++;
+   return level;
+}
+
+int ShadowAtlas::getUsedTexelRatioInPercent() const
+{
+   size_t used_texel_num = 0;
+   for (const auto& allocation : Allocations) {
+      used_texel_num += static_cast<size_t>(allocation.second.Size) * static_cast<size_t>(allocation.second.Size);
+   }
+   const size_t texel_num = static_cast<size_t>(AtlasSize) * static_cast<size_t>(AtlasSize);
+   return static_cast<int>(used_texel_num * 100 / texel_num);
+}
+
+bool ShadowAtlas::allocate(int level, glm::ivec2& position)
+{
+   if (!FreeTiles[level].empty()) {
+      position = FreeTiles[level].back();
+      FreeTiles[level].pop_back();
+      return true;
+   }
+   if (level == 0) return false;
+
+   // a free tile of the level above is split, and the three siblings stay free.
+   glm::ivec2 parent;
+   if (!allocate( level - 1, parent )) return false;
+
+   const int size = AtlasSize >> level;
+   FreeTiles[level].emplace_back( parent.x + size, parent.y );
+   FreeTiles[level].emplace_back( parent.x, parent.y + size );
+   FreeTiles[level].emplace_back( parent.x + size, parent.y + size );
+   position = parent;
+   return true;
+}
+
+void ShadowAtlas::free(int level, const glm::ivec2& position)
+{
+   if (level == 0) {
+      FreeTiles[0].emplace_back( position );
+      return;
+   }
+
+   // the four siblings merge back into their parent as soon as all of them are free.
+   const int size = AtlasSize >> level;
+   const glm::ivec2 parent = position / (2 * size) * (2 * size);
+   std::vector<glm::ivec2>& free_tiles = FreeTiles[level];
+   int free_sibling_num = 0;
+   for (int i = 0; i < 4; ++i) {
+      const glm::ivec2 sibling = parent + glm::ivec2(i & 1, i >> 1) * size;
+      if (sibling == position) continue;
+      if (std::find( free_tiles.begin(), free_tiles.end(), sibling ) != free_tiles.end()) free_sibling_num++;
+   }
+   if (free_sibling_num < 3) {
+      free_tiles.emplace_back( position );
+      return;
+   }
+
+   free_tiles.erase(
+      std::remove_if(
+         free_tiles.begin(), free_tiles.end(),
+         [&parent, size](const glm::ivec2& tile) { return tile / (2 * size) * (2 * size) == parent; }
+      ),
+      free_tiles.end()
+   );
+   free( level - 1, parent );
+}
+
+bool ShadowAtlas::evictLeastRecentlyUsed()
+{
+   // the tiles used in this frame are never evicted, so a light cannot take the tile of another one drawn now.
+   auto least_recently_used = Allocations.end();
+   for (auto it = Allocations.begin(); it != Allocations.end(); ++it) {
+      if (it->second.LastUsedFrame == FrameIndex) continue;
+      if (least_recently_used == Allocations.end() ||
+          it->second.LastUsedFrame < least_recently_used->second.LastUsedFrame) {
+         least_recently_used = it;
+      }
+   }
+   if (least_recently_used == Allocations.end()) return false;
+
+   release( least_recently_used->first );
+   return true;
+}
+
+bool ShadowAtlas::acquire(
+   int owner,
+   int tile_size,
+   const glm::mat4& view_projection,
+   glm::ivec4& tile,
+   bool& is_dirty
+)
+{
+   tile_size = std::clamp( tile_size, MinTileSize, AtlasSize );
+   auto it = Allocations.find( owner );
+   if (it != Allocations.end() && it->second.Size == tile_size) {
+      Allocation& allocation = it->second;
+      is_dirty = !allocation.IsValid || allocation.ViewProjection != view_projection;
+      allocation.ViewProjection = view_projection;
+      allocation.LastUsedFrame = FrameIndex;
+      allocation.IsValid = true;
+      tile = glm::ivec4(allocation.Position, allocation.Size, allocation.Size);
+      return true;
+   }
+   if (it != Allocations.end()) release( owner );
+
+   // a smaller tile is taken only when even the eviction cannot make room for the requested one.
+   for (int size = tile_size; size >= MinTileSize; size /= 2) {
+      const int level = getLevel( size );
+      glm::ivec2 position;
+      bool is_allocated = allocate( level, position );
+      while (!is_allocated && evictLeastRecentlyUsed()) is_allocated = allocate( level, position );
+      if (!is_allocated) continue;
+
+      Allocations[owner] = { position, AtlasSize >> level, FrameIndex, true, view_projection };
+      tile = glm::ivec4(position, AtlasSize >> level, AtlasSize >> level);
+      is_dirty = true;
+      return true;
+   }
+   return false;
+}
+
+void ShadowAtlas::release(int owner)
+{
+   const auto it = Allocations.find( owner );
+   if (it == Allocations.end()) return;
+
+   free( getLevel( it->second.Size ), it->second.Position );
+   Allocations.erase( it );
+}
+
+void ShadowAtlas::invalidate()
+{
+   for (auto& allocation : Allocations) allocation.second.IsValid = false;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "timer.h"
+
+TimerGL::TimerGL() : Current( 0 ), Recording( false ), ElapsedTime( 0.0 ), Issued{}, Queries{}
+{
+   glCreateQueries( GL_TIMESTAMP, static_cast<GLsizei>(Queries.size()), Queries.data() );
+}
+
+TimerGL::~TimerGL()
+{
+   glDeleteQueries( static_cast<GLsizei>(Queries.size()), Queries.data() );
+}
+
+void TimerGL::collectElapsedTime(int index)
+{
+   if (!Issued[index]) return;
+
+   GLint available = 0;
+   glGetQueryObjectiv( Queries[index * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available );
+   if (available == GL_FALSE) return;
+
+   GLuint64 start = 0, end = 0;
+   glGetQueryObjectui64v( Queries[index * 2], GL_QUERY_RESULT, &start );
+   glGetQueryObjectui64v( Queries[index * 2 + 1], GL_QUERY_RESULT, &end );
+   Issued[index] = false;
+
+   // smooth the result to keep the displayed value readable.
+   constexpr double weight = 0.1;
+   const double elapsed_time = static_cast<double>(end - start) * 1e-6;
+   ElapsedTime = ElapsedTime > 0.0 ? glm::mix( ElapsedTime, elapsed_time, weight ) : elapsed_time;
+}
+
+void TimerGL::begin()
+{
+   // when the gpu is more frames behind than the ring holds, the slot still waits for its result,
+   // so this frame is not measured rather than stalling or overwriting the pending queries.
+   collectElapsedTime( Current );
+   Recording = !Issued[Current];
+   if (Recording) glQueryCounter( Queries[Current * 2], GL_TIMESTAMP );
+}
+
+void TimerGL::end()
+{
+   if (!Recording) return;
+
+   glQueryCounter( Queries[Current * 2 + 1], GL_TIMESTAMP );
+   Issued[Current] = true;
+   Current = (Current + 1) % QueryFrameNum;
+}
\ No newline at end of file